@@ -0,0 +1,234 @@
+/**
+ * @file bench_can_decode.c
+ * @brief Reproduz um log de CAN pelo decodificador do firmware (can_decoder.c) no Linux
+ *
+ * Compilar e rodar a partir da raiz do projeto:
+ *
+ *     gcc -O2 -I. bench/bench_can_decode.c can_decoder.c -o bench_can_decode
+ *     candump -l can0                          # grava candump-AAAA-MM-DD_hhmmss.log no carro
+ *     ./bench_can_decode candump-....log [repetições] [corromper a cada N]
+ *     ./bench_can_decode                       # sem log: tráfego sintético de powertrain
+ *
+ * Cada quadro do log vira o trem de bits que o PIO amostraria (stuffing, CRC,
+ * ACK, EOF), um atrás do outro como num barramento a 100% de carga, empacotado
+ * em palavras de 32 bits como o FIFO entrega. Com "corromper a cada N", um
+ * bit de cada N-ésimo quadro é invertido e o quadro tem que sumir como erro.
+ *
+ * Confere que os quadros decodificados são exatamente os do log (menos os
+ * corrompidos e, no máximo, o quadro seguinte a cada um), aplica a tabela de
+ * sinais de exemplo e imprime a vazão do decodificador em bits/s comparada a
+ * um barramento de 500 kbit/s lotado.
+ * Termina com erro se algum quadro veio diferente ou sumiu sem motivo.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "can_decoder.h"
+
+#define BUS_BITRATE 500000
+
+// Mesma tabela de exemplo de shift_light.c (slot 0 = rpm, 1 = velocidade)
+static const can_signal_t signals[] = {
+    { .id = 0x0FD, .slot = 1, .start_bit = 32, .length = 16, .mul = 1, .div = 100 },
+    { .id = 0x107, .slot = 0, .start_bit = 16, .length = 16, .mul = 1, .div = 4 },
+};
+
+typedef struct {
+    const can_frame_t *expected;
+    const size_t *order;   // Índices dos quadros não corrompidos, em ordem
+    size_t order_count;
+    size_t next;
+    uint32_t mismatches;   // Decodificado mas fora do log: o pior caso, nunca pode acontecer
+    uint32_t lost;         // Quadro bom perdido (um corrompido que mudou o DLC engole o seguinte)
+    uint32_t signal_values[2];
+    int32_t signal_last[2];
+} bench_t;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "(1436509052.249713) can0 107#1200403600" ou "can0 18DAF110#R"; CAN FD ("##") fica de fora
+static int parse_candump_line(const char *line, can_frame_t *frame) {
+    const char *hash = strchr(line, '#');
+    if (!hash || hash[1] == '#') return 0;
+
+    const char *p = hash;
+    while (p > line && hex_digit(p[-1]) >= 0) p--;
+    size_t id_len = (size_t)(hash - p);
+    if (id_len == 0 || id_len > 8) return 0;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->id = (uint32_t)strtoul(p, NULL, 16);
+    if (id_len > 3) frame->id |= CAN_ID_EXT; // candump escreve IDs estendidos com 8 dígitos
+
+    p = hash + 1;
+    if (*p == 'R') {
+        frame->id |= CAN_ID_RTR;
+        frame->dlc = (uint8_t)(hex_digit(p[1]) >= 0 ? hex_digit(p[1]) : 0);
+        return 1;
+    }
+    while (frame->dlc < 8 && hex_digit(p[0]) >= 0 && hex_digit(p[1]) >= 0) {
+        frame->data[frame->dlc++] = (uint8_t)(hex_digit(p[0]) << 4 | hex_digit(p[1]));
+        p += 2;
+        if (*p == '.') p++; // candump -l aceita "11.22.33"
+    }
+    return 1;
+}
+
+static size_t load_log(const char *path, can_frame_t **out) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    size_t count = 0, cap = 1024;
+    can_frame_t *frames = malloc(cap * sizeof(*frames));
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (count == cap) frames = realloc(frames, (cap *= 2) * sizeof(*frames));
+        count += (size_t)parse_candump_line(line, &frames[count]);
+    }
+    fclose(f);
+    *out = frames;
+    return count;
+}
+
+// Um segundo de barramento de powertrain: RPM e velocidade a 100 Hz, mais
+// ~20 IDs de outras ECUs entre 10 e 100 Hz e um estendido de diagnóstico
+static size_t synth_log(can_frame_t **out) {
+    size_t cap = 4096, count = 0;
+    can_frame_t *frames = calloc(cap, sizeof(*frames));
+    uint32_t rng = 12345;
+
+    for (int tick = 0; tick < 100 && count + 32 < cap; tick++) {
+        uint32_t rpm_x4 = (uint32_t)(800 + tick * 50) * 4;
+        uint32_t speed = (uint32_t)tick * 120;
+        can_frame_t rpm = { .id = 0x107, .dlc = 8, .data = { 0, 0, rpm_x4 & 0xFF, rpm_x4 >> 8 } };
+        can_frame_t spd = { .id = 0x0FD, .dlc = 8, .data = { 0, 0, 0, 0, speed & 0xFF, speed >> 8 } };
+        frames[count++] = rpm;
+        frames[count++] = spd;
+        for (int k = 0; k < 20; k++) {
+            if ((tick % (1 + k % 10)) != 0) continue; // 10..100 Hz
+            can_frame_t other = { .id = 0x100 + (uint32_t)k * 0x23, .dlc = (uint8_t)(1 + k % 8) };
+            for (int b = 0; b < other.dlc; b++) {
+                rng = rng * 1103515245u + 12345u;
+                other.data[b] = (uint8_t)(rng >> 16);
+            }
+            frames[count++] = other;
+        }
+        if (tick % 10 == 0) {
+            can_frame_t diag = { .id = 0x18DAF110 | CAN_ID_EXT, .dlc = 8, .data = { 0x02, 0x01, 0x0C } };
+            frames[count++] = diag;
+        }
+    }
+    *out = frames;
+    return count;
+}
+
+static void on_frame(void *ctx, const can_frame_t *frame) {
+    bench_t *b = ctx;
+
+    // Procura um pouco à frente para ressincronizar depois de quadros perdidos
+    size_t k = b->next;
+    for (; k < b->order_count && k < b->next + 8; k++) {
+        const can_frame_t *want = &b->expected[b->order[k]];
+        size_t len = (want->id & CAN_ID_RTR) ? 0 : (want->dlc > 8 ? 8 : want->dlc);
+        if (frame->id == want->id && frame->dlc == want->dlc && memcmp(frame->data, want->data, len) == 0) break;
+    }
+    if (k == b->order_count || k == b->next + 8) {
+        b->mismatches++;
+        return;
+    }
+    b->lost += (uint32_t)(k - b->next);
+    b->next = k + 1;
+
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        int32_t value;
+        if (can_signal_decode(&signals[i], frame, &value)) {
+            b->signal_values[signals[i].slot]++;
+            b->signal_last[signals[i].slot] = value;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    can_frame_t *frames;
+    size_t count = (argc > 1 && strcmp(argv[1], "-") != 0) ? load_log(argv[1], &frames) : synth_log(&frames);
+    int repeat = argc > 2 ? atoi(argv[2]) : 200;
+    int corrupt_every = argc > 3 ? atoi(argv[3]) : 0;
+    if (count == 0) {
+        fprintf(stderr, "nenhum quadro no log\n");
+        return 2;
+    }
+
+    // Trem de bits de todos os quadros, com barramento livre só antes do primeiro
+    size_t max_bits = CAN_IDLE_BITS + count * CAN_MAX_FRAME_BITS;
+    uint8_t *bits = malloc(max_bits);
+    size_t *order = malloc(count * sizeof(*order));
+    size_t nbits = CAN_IDLE_BITS, order_count = 0, corrupted = 0;
+    memset(bits, 1, CAN_IDLE_BITS);
+    for (size_t i = 0; i < count; i++) {
+        size_t n = can_encode_frame(&frames[i], &bits[nbits], max_bits - nbits);
+        if (corrupt_every > 0 && i % (size_t)corrupt_every == (size_t)corrupt_every - 1) {
+            bits[nbits + 1 + (i * 7) % (n - 14)] ^= 1; // Um bit entre o SOF e o CRC
+            corrupted++;
+        } else {
+            order[order_count++] = i;
+        }
+        nbits += n;
+    }
+
+    size_t nwords = (nbits + 31) / 32;
+    uint32_t *words = malloc(nwords * sizeof(*words));
+    memset(words, 0xFF, nwords * sizeof(*words)); // Sobra da última palavra = barramento livre
+    for (size_t i = 0; i < nbits; i++) {
+        if (!bits[i]) words[i / 32] &= ~(0x80000000u >> (i % 32));
+    }
+
+    // Primeira passada confere o conteúdo; as demais só medem
+    bench_t b = { .expected = frames, .order = order, .order_count = order_count };
+    static can_decoder_t dec;
+    can_decoder_init(&dec, on_frame, &b);
+    for (size_t i = 0; i < nwords; i++) can_decoder_feed_word(&dec, words[i]);
+    can_decoder_stats_t first = dec.stats;
+    b.lost += (uint32_t)(order_count - b.next);
+
+    can_decoder_init(&dec, NULL, NULL);
+    double t0 = now_s();
+    for (int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < nwords; i++) can_decoder_feed_word(&dec, words[i]);
+    }
+    double elapsed = now_s() - t0;
+
+    double bits_total = (double)nwords * 32 * repeat;
+    printf("%zu quadros (%zu corrompidos), %zu bits no barramento (%.1f ms a %d kbit/s)\n", count, corrupted,
+           nbits, nbits * 1000.0 / BUS_BITRATE, BUS_BITRATE / 1000);
+    printf("decodificados: %u (ACK %u), erros stuff %u, CRC %u, forma %u\n", first.frames, first.frames_acked,
+           first.stuff_errors, first.crc_errors, first.form_errors);
+    printf("quadros bons perdidos: %u, decodificados fora do log: %u\n", b.lost, b.mismatches);
+    printf("sinais: rpm %u valores (último %d), velocidade %u valores (último %d)\n", b.signal_values[0],
+           (int)b.signal_last[0], b.signal_values[1], (int)b.signal_last[1]);
+    printf("vazão: %.1f Mbit/s, %.2f ns/bit, %.0f quadros/s (%.0fx um barramento de %d kbit/s lotado)\n",
+           bits_total / elapsed / 1e6, elapsed * 1e9 / bits_total, (double)first.frames * repeat / elapsed,
+           bits_total / elapsed / BUS_BITRATE, BUS_BITRATE / 1000);
+
+    // Sem corrupção nada pode sumir; com ela, só quadros colados a um corrompido
+    bool ok = b.mismatches == 0 && (corrupted ? b.lost <= corrupted : b.lost == 0);
+    free(words);
+    free(order);
+    free(bits);
+    free(frames);
+    return ok ? 0 : 1;
+}
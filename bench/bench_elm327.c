@@ -0,0 +1,130 @@
+/**
+ * @file bench_elm327.c
+ * @brief Roda o cliente ELM327 do firmware no Linux contra o simulador (elm327_sim.py)
+ *
+ * Compilar e rodar a partir da raiz do projeto:
+ *
+ *     python gen_channels.py --c-out build/generated
+ *     gcc -O2 -I. -Ibuild/generated bench/bench_elm327.c elm327.c build/generated/channel_table.c -o bench_elm327
+ *     python elm327_sim.py &          # imprime /dev/pts/N
+ *     ./bench_elm327 /dev/pts/N [segundos] [Hz por canal]
+ *
+ * Pede todos os canais na taxa dada (padrão 100 Hz, acima do que o adaptador
+ * entrega, para medir a vazão máxima) e imprime pedidos/s, latência pedido ->
+ * prompt, quantas vezes o laço acordou e a taxa obtida por canal. O laço
+ * dorme no poll() até chegar byte ou vencer elm327_next_poll_us(), como o
+ * núcleo 1 em __wfe(). Termina com erro se nenhum canal chegou.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "elm327.h"
+
+typedef struct {
+    int fd;
+    uint32_t count[CH_COUNT];
+    int32_t last[CH_COUNT];
+} bench_t;
+
+static uint32_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+}
+
+static void bench_write(void *ctx, const char *data, size_t len) {
+    bench_t *b = ctx;
+    if (write(b->fd, data, len) != (ssize_t)len) perror("write");
+}
+
+static void bench_value(void *ctx, uint8_t tag, int32_t wire_value, uint32_t t_us) {
+    bench_t *b = ctx;
+    uint8_t slot = channel_slot_by_tag[tag];
+    (void)t_us;
+    if (slot == CH_NONE) return;
+    b->count[slot]++;
+    b->last[slot] = wire_value;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "uso: %s /dev/pts/N [segundos] [Hz por canal]\n", argv[0]);
+        return 2;
+    }
+    double seconds = argc > 2 ? atof(argv[2]) : 10.0;
+    int rate_hz = argc > 3 ? atoi(argv[3]) : 100;
+
+    bench_t b = { 0 };
+    b.fd = open(argv[1], O_RDWR | O_NOCTTY);
+    if (b.fd < 0) {
+        perror(argv[1]);
+        return 2;
+    }
+    struct termios tio;
+    tcgetattr(b.fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(b.fd, TCSANOW, &tio);
+
+    static elm327_t elm;
+    elm327_init(&elm, bench_write, bench_value, &b, now_us());
+    for (int slot = 0; slot < CH_COUNT; slot++) elm327_set_rate(&elm, slot, (uint16_t)(rate_hz * 100));
+
+    // Só conta a partir do primeiro pedido de dados (ATZ e busca de protocolo ficam de fora)
+    uint32_t begin = now_us();
+    uint32_t start = 0;
+    uint32_t requests_at_start = 0;
+    uint64_t latency_at_start = 0;
+    uint32_t wakeups = 0;
+    uint32_t t = begin;
+    while (start == 0 || t - start < (uint32_t)(seconds * 1e6)) {
+        struct pollfd pfd = { b.fd, POLLIN, 0 };
+        uint8_t buf[128];
+
+        // Dorme como o núcleo 1: até chegar byte ou vencer o próximo prazo do cliente
+        uint32_t wait_us = elm327_next_poll_us(&elm, now_us());
+        int timeout_ms = wait_us == UINT32_MAX ? 1000 : (int)((wait_us + 999) / 1000);
+        wakeups++;
+        if (poll(&pfd, 1, timeout_ms) > 0) {
+            ssize_t n = read(b.fd, buf, sizeof(buf));
+            if (n > 0) elm327_feed(&elm, buf, (size_t)n, now_us());
+        }
+        t = now_us();
+        elm327_poll(&elm, t);
+
+        if (start == 0 && elm.state == ELM327_POLLING) {
+            start = t;
+            requests_at_start = elm.stats.requests;
+            latency_at_start = elm.stats.total_latency_us;
+            elm.stats.max_latency_us = 0;
+            wakeups = 0;
+            for (int slot = 0; slot < CH_COUNT; slot++) b.count[slot] = 0;
+        } else if (start == 0 && t - begin > 15000000u) {
+            fprintf(stderr, "adaptador não inicializou (estado %d)\n", elm.state);
+            return 1;
+        }
+    }
+
+    double elapsed = (t - start) / 1e6;
+    uint32_t requests = elm.stats.requests - requests_at_start;
+    printf("%.1f s, lote de até %d PIDs, sufixo de respostas %s\n", elapsed, elm.max_batch,
+           elm.response_count ? "ligado" : "desligado");
+    printf("pedidos: %u (%.1f/s), latência média %.1f ms, máx %.1f ms\n", requests, requests / elapsed,
+           requests ? (elm.stats.total_latency_us - latency_at_start) / 1000.0 / requests : 0.0,
+           elm.stats.max_latency_us / 1000.0);
+    printf("acordou %u vezes (%.1f por pedido)\n", wakeups, requests ? (double)wakeups / requests : 0.0);
+    printf("sem dados: %u, erros: %u, timeouts: %u, resets: %u\n", elm.stats.no_data, elm.stats.errors,
+           elm.stats.timeouts, elm.stats.resets);
+
+    uint32_t total = 0;
+    for (int slot = 0; slot < CH_COUNT; slot++) {
+        printf("  %-10s %6.1f Hz  último %d\n", channel_info[slot].name, b.count[slot] / elapsed, (int)b.last[slot]);
+        total += b.count[slot];
+    }
+    close(b.fd);
+    return total ? 0 : 1;
+}
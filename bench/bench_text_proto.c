@@ -0,0 +1,88 @@
+/**
+ * @file bench_text_proto.c
+ * @brief Microbenchmark no Linux: tp_parse_tag_value x sscanf("%d,%d")
+ *
+ * Compilar e rodar a partir da raiz do projeto:
+ *
+ *     gcc -O2 -I. bench/bench_text_proto.c telemetry_proto.c -o bench_text_proto
+ *     ./bench_text_proto [linhas]
+ *
+ * Mede ciclos por linha (TSC no x86, ns nos demais) para o mesmo conjunto de
+ * linhas "tag,valor" e confere que os dois caminhos chegam ao mesmo resultado.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "telemetry_proto.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT "ciclos"
+static inline uint64_t now_cycles(void) { return __rdtsc(); }
+#else
+#define CYCLE_UNIT "ns"
+static inline uint64_t now_cycles(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#define LINE_LEN 24
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+    char (*lines)[LINE_LEN] = malloc((size_t)count * LINE_LEN);
+    if (lines == NULL || count <= 0) return 1;
+
+    // Mesma mistura que o get_rpm.py envia: RPM, IAT negativo, consumo*100...
+    srand(1234);
+    for (int i = 0; i < count; i++) {
+        int tag = 1 + rand() % 7;
+        int value = (tag == 2) ? (rand() % 100) - 40 : rand() % 9000;
+        snprintf(lines[i], LINE_LEN, "%d,%d", tag, value);
+    }
+
+    volatile int64_t sink = 0;
+    int tag;
+    int32_t value;
+    int stag, svalue;
+
+    uint64_t t0 = now_cycles();
+    for (int i = 0; i < count; i++) {
+        if (sscanf(lines[i], "%d,%d", &stag, &svalue) == 2) sink += stag + svalue;
+    }
+    uint64_t t1 = now_cycles();
+    for (int i = 0; i < count; i++) {
+        if (tp_parse_tag_value(lines[i], &tag, &value)) sink += tag + value;
+    }
+    uint64_t t2 = now_cycles();
+
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        bool ok = tp_parse_tag_value(lines[i], &tag, &value);
+        if (!ok || sscanf(lines[i], "%d,%d", &stag, &svalue) != 2 || stag != tag || svalue != value) mismatches++;
+    }
+
+    // Linhas que o parser precisa rejeitar
+    static const char *bad[] = { "", ",", "1,", ",1", "1,,2", "1;2", "1,2x", "a,1", "1,99999999999", "1,2,3", "-,5" };
+    int accepted_bad = 0;
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        if (tp_parse_tag_value(bad[i], &tag, &value)) {
+            printf("ACEITOU linha inválida: \"%s\"\n", bad[i]);
+            accepted_bad++;
+        }
+    }
+
+    double per_sscanf = (double)(t1 - t0) / count;
+    double per_tp = (double)(t2 - t1) / count;
+    printf("linhas: %d\n", count);
+    printf("sscanf            : %8.1f %s/linha\n", per_sscanf, CYCLE_UNIT);
+    printf("tp_parse_tag_value: %8.1f %s/linha (%.1fx)\n", per_tp, CYCLE_UNIT, per_sscanf / per_tp);
+    printf("divergências: %d, inválidas aceitas: %d\n", mismatches, accepted_bad);
+
+    free(lines);
+    return (mismatches || accepted_bad) ? 1 : 0;
+}
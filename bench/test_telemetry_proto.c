@@ -0,0 +1,283 @@
+/**
+ * @file test_telemetry_proto.c
+ * @brief Testes no Linux do protocolo de telemetria (telemetry_proto.c)
+ *
+ * Compilar e rodar a partir da raiz do projeto:
+ *
+ *     gcc -O2 -Wall -I. bench/test_telemetry_proto.c telemetry_proto.c -o test_telemetry_proto
+ *     ./test_telemetry_proto
+ *
+ * Cobre COBS nos limites de bloco (253/254/255 bytes sem zero), o valor de
+ * conferência do CRC-16/CCITT-FALSE, varint zigzag nos extremos, a rejeição
+ * de quadros corrompidos pelo tp_rx_feed, linhas de texto misturadas com
+ * quadros (inclusive depois de um 0x00 perdido no meio do texto) e quadros
+ * gerados pelo telemetry_proto.py. Termina com erro se algum caso falhar.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "telemetry_proto.h"
+
+static int failures;
+
+#define CHECK(cond) do {                                                  \
+        if (!(cond)) {                                                    \
+            printf("FALHOU %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                   \
+        }                                                                 \
+    } while (0)
+
+// Quadros do telemetry_proto.py, delimitadores incluídos:
+//   encode_frame(TP_MSG_SWEEP, varints de (123456, 3500, 87, -12, 845, 92, 15, 147))
+static const uint8_t py_sweep[] = {
+    0x00, 0x13, 0x02, 0x80, 0x89, 0x0F, 0xD8, 0x36, 0xAE, 0x01, 0x17, 0x9A,
+    0x0D, 0xB8, 0x01, 0x1E, 0xA6, 0x02, 0x6F, 0x6C, 0x00,
+};
+static const int32_t py_sweep_values[] = { 3500, 87, -12, 845, 92, 15, 147 };
+
+//   encode_delta(123500, 0b101, [3600, 70]) -- tem um 0x0A ('\n') no meio
+static const uint8_t py_delta[] = {
+    0x00, 0x0C, 0x03, 0xD8, 0x89, 0x0F, 0x0A, 0xA0, 0x38, 0x8C, 0x01, 0x37,
+    0xD6, 0x00,
+};
+
+typedef struct {
+    int lines;
+    int frames;
+    char last_line[TP_MAX_LINE];
+    uint8_t last_type;
+} feed_result_t;
+
+static void feed(tp_rx_t *rx, const uint8_t *data, size_t len, feed_result_t *res) {
+    for (size_t i = 0; i < len; i++) {
+        tp_rx_event_t ev = tp_rx_feed(rx, data[i]);
+        if (ev == TP_RX_LINE) {
+            res->lines++;
+            strcpy(res->last_line, rx->line);
+        } else if (ev == TP_RX_FRAME) {
+            res->frames++;
+            res->last_type = rx->payload[0];
+        }
+    }
+}
+
+static void feed_str(tp_rx_t *rx, const char *s, feed_result_t *res) {
+    feed(rx, (const uint8_t *)s, strlen(s), res);
+}
+
+static void test_cobs_runs(void) {
+    static uint8_t src[600], enc[700], dec[600];
+    static const size_t runs[] = { 253, 254, 255 };
+
+    for (size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++) {
+        // Bloco sem zeros sozinho, e cercado de zeros dos dois lados
+        for (int framed = 0; framed < 2; framed++) {
+            size_t len = 0;
+            if (framed) src[len++] = 0;
+            for (size_t i = 0; i < runs[r]; i++) src[len++] = (uint8_t)(1 + i % 255);
+            if (framed) src[len++] = 0;
+
+            size_t n = tp_cobs_encode(src, len, enc, sizeof(enc));
+            CHECK(n > len && n <= len + len / 254 + 1);
+            CHECK(memchr(enc, 0, n) == NULL);
+            size_t m = tp_cobs_decode(enc, n, dec, sizeof(dec));
+            CHECK(m == len && memcmp(src, dec, len) == 0);
+        }
+    }
+
+    // Saída pequena demais e bloco com zero dentro são recusados
+    CHECK(tp_cobs_encode(src, 254, enc, 254) == 0);
+    const uint8_t bad[] = { 0x03, 0x11, 0x00 };
+    CHECK(tp_cobs_decode(bad, sizeof(bad), dec, sizeof(dec)) == 0);
+    const uint8_t short_block[] = { 0x05, 0x11, 0x22 };
+    CHECK(tp_cobs_decode(short_block, sizeof(short_block), dec, sizeof(dec)) == 0);
+}
+
+static void test_crc16(void) {
+    CHECK(tp_crc16((const uint8_t *)"123456789", 9) == 0x29B1);
+    CHECK(tp_crc16(NULL, 0) == 0xFFFF);
+}
+
+static void test_varint(void) {
+    static const int32_t values[] = { 0, 1, -1, INT32_MAX, INT32_MIN };
+    static const uint8_t first_byte[] = { 0x00, 0x02, 0x01, 0xFE, 0xFF };
+    uint8_t frame[TP_MAX_FRAME + 2];
+    tp_rx_t rx;
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        tp_channel_t ch = { .tag = 9, .value = values[i] };
+        size_t n = tp_encode_telemetry(&ch, 1, frame, sizeof(frame));
+        CHECK(n > 0);
+
+        tp_rx_init(&rx);
+        tp_rx_event_t ev = TP_RX_NONE;
+        for (size_t k = 0; k < n; k++) ev = tp_rx_feed(&rx, frame[k]);
+        CHECK(ev == TP_RX_FRAME);
+
+        // Zigzag: 0, 1 -> 2, -1 -> 1, MAX -> 0xFFFFFFFE, MIN -> 0xFFFFFFFF
+        CHECK(rx.payload[2] == first_byte[i]);
+        CHECK(rx.payload_len == (values[i] == 0 || values[i] == 1 || values[i] == -1 ? 3u : 7u));
+
+        tp_telemetry_t t;
+        CHECK(tp_parse_telemetry(rx.payload, rx.payload_len, &t));
+        CHECK(t.count == 1 && t.ch[0].tag == 9 && t.ch[0].value == values[i]);
+    }
+
+    // Varint que não termina em 5 bytes é recusado
+    const uint8_t endless[] = { TP_MSG_TELEMETRY, 1, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 };
+    tp_telemetry_t t;
+    CHECK(!tp_parse_telemetry(endless, sizeof(endless), &t));
+}
+
+static void test_rx_rejects(void) {
+    uint8_t frame[TP_MAX_FRAME + 2];
+    tp_channel_t ch = { .tag = 1, .value = 3500 };
+    size_t n = tp_encode_telemetry(&ch, 1, frame, sizeof(frame));
+    tp_rx_t rx;
+    feed_result_t res;
+
+    // Byte do corpo trocado: CRC
+    uint8_t bad_crc[sizeof(frame)];
+    memcpy(bad_crc, frame, n);
+    bad_crc[3] ^= 0x40;
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    feed(&rx, bad_crc, n, &res);
+    CHECK(res.frames == 0 && rx.frames_bad_crc == 1);
+
+    // Código COBS apontando além do fim do bloco
+    uint8_t bad_cobs[sizeof(frame)];
+    memcpy(bad_cobs, frame, n);
+    bad_cobs[1] = 0x30;
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    feed(&rx, bad_cobs, n, &res);
+    CHECK(res.frames == 0 && rx.frames_bad_cobs == 1);
+
+    // Quadro truncado: o delimitador final chega cedo
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    feed(&rx, frame, n - 3, &res);
+    tp_rx_feed(&rx, 0x00);
+    CHECK(res.frames == 0 && rx.frames_bad_cobs + rx.frames_bad_crc == 1);
+
+    // ...e o quadro inteiro logo depois ainda passa (o 0x00 vira o inicial)
+    feed(&rx, frame + 1, n - 1, &res);
+    CHECK(res.frames == 1 && rx.frames_ok == 1);
+
+    // Quadro curto demais para ter tipo + CRC
+    const uint8_t tiny[] = { 0x00, 0x02, 0x01, 0x00 };
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    feed(&rx, tiny, sizeof(tiny), &res);
+    CHECK(res.frames == 0 && rx.frames_bad_cobs == 1);
+}
+
+static void test_rx_mixed(void) {
+    tp_rx_t rx;
+    feed_result_t res;
+
+    // Linhas e quadros intercalados, com um '\n' dentro do quadro delta
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    feed_str(&rx, "1,3000\n", &res);
+    feed(&rx, py_delta, sizeof(py_delta), &res);
+    feed_str(&rx, "2,-15\r\n", &res);
+    feed(&rx, py_sweep, sizeof(py_sweep), &res);
+    feed(&rx, py_sweep, sizeof(py_sweep), &res);
+    feed_str(&rx, "S,10,3500\n", &res);
+    CHECK(res.lines == 3 && res.frames == 3);
+    CHECK(strcmp(res.last_line, "S,10,3500") == 0);
+    CHECK(rx.frames_bad_cobs == 0 && rx.frames_bad_crc == 0 && rx.overflows == 0);
+
+    // Linha longa demais é descartada inteira, a seguinte passa
+    char long_line[TP_MAX_LINE * 2 + 2];
+    memset(long_line, '7', sizeof(long_line) - 2);
+    long_line[sizeof(long_line) - 2] = '\n';
+    long_line[sizeof(long_line) - 1] = '\0';
+    memset(&res, 0, sizeof(res));
+    feed_str(&rx, long_line, &res);
+    feed_str(&rx, "3,42\n", &res);
+    CHECK(res.lines == 1 && strcmp(res.last_line, "3,42") == 0 && rx.overflows == 1);
+}
+
+static void test_rx_stray_delimiter(void) {
+    tp_rx_t rx;
+    feed_result_t res;
+
+    // Host só de texto: um 0x00 solto (ruído ao abrir a porta) não pode
+    // calar o receptor. Perde-se no máximo o que cabe num quadro.
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    tp_rx_feed(&rx, 0x00);
+    for (int i = 0; i < 1000; i++) feed_str(&rx, "1,3000\n", &res);
+    CHECK(res.lines >= 1000 - (TP_MAX_FRAME / 7 + 2));
+    CHECK(strcmp(res.last_line, "1,3000") == 0);
+    CHECK(!rx.in_frame && !rx.overflow);
+
+    // Fluxo misto: 0x00 solto, texto, depois quadro e linha válidos
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    tp_rx_feed(&rx, 0x00);
+    feed_str(&rx, "1,3000\n1,3100\n", &res);
+    feed(&rx, py_sweep, sizeof(py_sweep), &res);
+    feed_str(&rx, "1,3200\n", &res);
+    CHECK(res.frames == 1 && res.last_type == TP_MSG_SWEEP);
+    CHECK(res.lines == 1 && strcmp(res.last_line, "1,3200") == 0);
+
+    // 00 00 ressincroniza no meio de um quadro perdido
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    feed(&rx, py_delta, sizeof(py_delta) / 2, &res);
+    tp_rx_feed(&rx, 0x00);
+    feed(&rx, py_delta, sizeof(py_delta), &res);
+    feed_str(&rx, "4,1\n", &res);
+    CHECK(res.frames == 1 && res.last_type == TP_MSG_DELTA);
+    CHECK(res.lines == 1 && strcmp(res.last_line, "4,1") == 0);
+}
+
+static void test_python_vectors(void) {
+    tp_rx_t rx;
+    feed_result_t res;
+
+    tp_rx_init(&rx);
+    memset(&res, 0, sizeof(res));
+    feed(&rx, py_sweep, sizeof(py_sweep), &res);
+    CHECK(res.frames == 1);
+
+    tp_sweep_t sweep;
+    CHECK(tp_parse_sweep(rx.payload, rx.payload_len, &sweep));
+    CHECK(sweep.host_ms == 123456 && sweep.count == 7);
+    CHECK(memcmp(sweep.value, py_sweep_values, sizeof(py_sweep_values)) == 0);
+
+    // E o firmware gera exatamente os mesmos bytes
+    uint8_t out[TP_MAX_FRAME + 2];
+    size_t n = tp_encode_sweep(&sweep, out, sizeof(out));
+    CHECK(n == sizeof(py_sweep) && memcmp(out, py_sweep, n) == 0);
+
+    memset(&res, 0, sizeof(res));
+    feed(&rx, py_delta, sizeof(py_delta), &res);
+    CHECK(res.frames == 1);
+
+    tp_delta_t delta;
+    CHECK(tp_parse_delta(rx.payload, rx.payload_len, &delta));
+    CHECK(delta.host_ms == 123500 && delta.mask == 0x5);
+    CHECK(delta.value[0] == 3600 && delta.value[2] == 70);
+
+    n = tp_encode_delta(&delta, out, sizeof(out));
+    CHECK(n == sizeof(py_delta) && memcmp(out, py_delta, n) == 0);
+}
+
+int main(void) {
+    test_cobs_runs();
+    test_crc16();
+    test_varint();
+    test_rx_rejects();
+    test_rx_mixed();
+    test_rx_stray_delimiter();
+    test_python_vectors();
+
+    printf("%s (%d falha%s)\n", failures ? "FALHOU" : "ok", failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,270 @@
+/**
+ * @file can_decoder.c
+ * @brief Implementação do decodificador CAN (ver can_decoder.h)
+ */
+
+#include "can_decoder.h"
+#include <string.h>
+
+#define CAN_CRC15_POLY 0x4599
+
+// Posições dos campos nos bits de quadro (sem stuffing), contando o SOF como 0
+#define STD_HEADER_BITS 19 // SOF, ID 11, RTR, IDE, r0, DLC 4
+#define EXT_HEADER_BITS 39 // SOF, ID 11, SRR, IDE, ID 18, RTR, r1, r0, DLC 4
+#define IDE_BIT         13
+
+enum {
+    DEC_IDLE = 0,   // Esperando barramento livre + SOF
+    DEC_FRAME,      // SOF até o fim do CRC, com stuffing
+    DEC_TRAILER,    // Delimitador de CRC, ACK e delimitador de ACK
+};
+
+enum {
+    TRAILER_STUFF = 0, // Bit de stuffing depois de cinco bits iguais no fim do CRC
+    TRAILER_CRC_DELIM,
+    TRAILER_ACK,
+    TRAILER_ACK_DELIM,
+};
+
+static uint32_t get_bits(const uint8_t *raw, unsigned start, unsigned len) {
+    uint32_t v = 0;
+    for (unsigned i = start; i < start + len; i++) {
+        v = (v << 1) | ((raw[i >> 3] >> (7 - (i & 7))) & 1u);
+    }
+    return v;
+}
+
+static uint16_t crc15_bit(uint16_t crc, uint8_t bit) {
+    uint16_t next = (uint16_t)(crc << 1);
+    if (((crc >> 14) ^ bit) & 1u) next ^= CAN_CRC15_POLY;
+    return next & 0x7FFF;
+}
+
+static size_t data_len(bool rtr, uint32_t dlc) {
+    if (rtr) return 0;
+    return dlc > 8 ? 8 : dlc; // DLC 9..15 vale 8 bytes no CAN clássico
+}
+
+void can_decoder_init(can_decoder_t *dec, can_frame_fn on_frame, void *ctx) {
+    memset(dec, 0, sizeof(*dec));
+    dec->on_frame = on_frame;
+    dec->ctx = ctx;
+    dec->state = DEC_IDLE;
+}
+
+static void abort_frame(can_decoder_t *dec, uint32_t *counter) {
+    (*counter)++;
+    dec->state = DEC_IDLE;
+    dec->idle_run = 0; // Espera o quadro de erro dos outros nós e o barramento livre
+}
+
+static void push_bit(can_decoder_t *dec, uint8_t bit) {
+    if (dec->crc_start == 0 || dec->nbits < dec->crc_start) {
+        dec->crc = crc15_bit(dec->crc, bit);
+    }
+    if (bit) dec->raw[dec->nbits >> 3] |= (uint8_t)(0x80u >> (dec->nbits & 7));
+    dec->nbits++;
+
+    if (dec->crc_start == 0) {
+        // O tamanho do quadro só é conhecido depois do DLC
+        bool ext = get_bits(dec->raw, IDE_BIT, 1) != 0;
+        if (!ext && dec->nbits == STD_HEADER_BITS) {
+            bool rtr = get_bits(dec->raw, 12, 1) != 0;
+            dec->crc_start = (uint16_t)(STD_HEADER_BITS + 8 * data_len(rtr, get_bits(dec->raw, 15, 4)));
+        } else if (ext && dec->nbits == EXT_HEADER_BITS) {
+            bool rtr = get_bits(dec->raw, 32, 1) != 0;
+            dec->crc_start = (uint16_t)(EXT_HEADER_BITS + 8 * data_len(rtr, get_bits(dec->raw, 35, 4)));
+        }
+    } else if (dec->nbits == dec->crc_start + 15) {
+        if (get_bits(dec->raw, dec->crc_start, 15) != dec->crc) {
+            abort_frame(dec, &dec->stats.crc_errors);
+            return;
+        }
+        dec->state = DEC_TRAILER;
+        dec->trailer_pos = dec->run_len == 5 ? TRAILER_STUFF : TRAILER_CRC_DELIM;
+    }
+}
+
+static void start_frame(can_decoder_t *dec) {
+    dec->state = DEC_FRAME;
+    dec->nbits = 0;
+    dec->crc_start = 0;
+    dec->crc = 0;
+    dec->acked = false;
+    memset(dec->raw, 0, sizeof(dec->raw));
+    dec->last_bit = 0;
+    dec->run_len = 1;
+    push_bit(dec, 0); // SOF
+}
+
+static void finish_frame(can_decoder_t *dec) {
+    can_frame_t frame;
+    unsigned data_start;
+    bool rtr;
+
+    if (get_bits(dec->raw, IDE_BIT, 1)) {
+        frame.id = (get_bits(dec->raw, 1, 11) << 18) | get_bits(dec->raw, 14, 18) | CAN_ID_EXT;
+        rtr = get_bits(dec->raw, 32, 1) != 0;
+        data_start = EXT_HEADER_BITS;
+    } else {
+        frame.id = get_bits(dec->raw, 1, 11);
+        rtr = get_bits(dec->raw, 12, 1) != 0;
+        data_start = STD_HEADER_BITS;
+    }
+    if (rtr) frame.id |= CAN_ID_RTR;
+    frame.dlc = (uint8_t)get_bits(dec->raw, data_start - 4, 4);
+    memset(frame.data, 0, sizeof(frame.data));
+    for (size_t i = 0; i < data_len(rtr, frame.dlc); i++) {
+        frame.data[i] = (uint8_t)get_bits(dec->raw, data_start + 8 * (unsigned)i, 8);
+    }
+
+    dec->stats.frames++;
+    if (dec->acked) dec->stats.frames_acked++;
+    dec->state = DEC_IDLE;
+    dec->idle_run = 1; // O delimitador de ACK já conta
+    if (dec->on_frame) dec->on_frame(dec->ctx, &frame);
+}
+
+void can_decoder_feed_bit(can_decoder_t *dec, uint8_t bit) {
+    dec->stats.bits++;
+
+    switch (dec->state) {
+        case DEC_IDLE:
+            if (bit) {
+                dec->idle_run++;
+                return;
+            }
+            if (dec->idle_run >= CAN_IDLE_BITS) {
+                start_frame(dec);
+            } else {
+                dec->idle_run = 0; // Dominante no meio de EOF/erro: ainda não é um SOF
+            }
+            return;
+
+        case DEC_FRAME:
+            if (dec->run_len == 5) {
+                // Bit de stuffing: tem que ser o oposto e não entra no quadro
+                if (bit == dec->last_bit) {
+                    abort_frame(dec, &dec->stats.stuff_errors);
+                    return;
+                }
+                dec->last_bit = bit;
+                dec->run_len = 1;
+                return;
+            }
+            if (bit == dec->last_bit) {
+                dec->run_len++;
+            } else {
+                dec->last_bit = bit;
+                dec->run_len = 1;
+            }
+            push_bit(dec, bit);
+            return;
+
+        default:
+            switch (dec->trailer_pos++) {
+                case TRAILER_STUFF:
+                    if (bit == dec->last_bit) abort_frame(dec, &dec->stats.stuff_errors);
+                    return;
+                case TRAILER_CRC_DELIM:
+                    if (!bit) abort_frame(dec, &dec->stats.form_errors);
+                    return;
+                case TRAILER_ACK:
+                    dec->acked = !bit;
+                    return;
+                default:
+                    if (!bit) {
+                        abort_frame(dec, &dec->stats.form_errors);
+                    } else {
+                        finish_frame(dec);
+                    }
+                    return;
+            }
+    }
+}
+
+void can_decoder_feed_word(can_decoder_t *dec, uint32_t word) {
+    // Caminho rápido do barramento livre: a maior parte das palavras com carga baixa
+    if (word == 0xFFFFFFFFu && dec->state == DEC_IDLE) {
+        dec->stats.bits += 32;
+        dec->idle_run += 32;
+        return;
+    }
+    for (int i = 31; i >= 0; i--) {
+        can_decoder_feed_bit(dec, (uint8_t)((word >> i) & 1u));
+    }
+}
+
+bool can_signal_decode(const can_signal_t *sig, const can_frame_t *frame, int32_t *wire_value) {
+    if (frame->id != sig->id) return false; // Quadros remotos (CAN_ID_RTR) nunca batem
+    if (sig->length == 0 || sig->length > 32 || sig->div == 0) return false;
+    if ((size_t)sig->start_bit + sig->length > 8 * data_len(false, frame->dlc)) return false;
+
+    uint64_t bytes = 0;
+    for (int i = 7; i >= 0; i--) bytes = (bytes << 8) | frame->data[i];
+    uint64_t mask = (sig->length == 32) ? 0xFFFFFFFFu : ((1ull << sig->length) - 1);
+    int64_t raw = (int64_t)((bytes >> sig->start_bit) & mask);
+    if (sig->is_signed && (raw >> (sig->length - 1)) & 1) raw -= (int64_t)1 << sig->length;
+
+    *wire_value = (int32_t)(raw * sig->mul / sig->div + sig->offset);
+    return true;
+}
+
+static size_t put_bits(uint8_t *raw, size_t n, uint32_t value, unsigned len) {
+    while (len--) raw[n++] = (uint8_t)((value >> len) & 1u);
+    return n;
+}
+
+size_t can_encode_frame(const can_frame_t *frame, uint8_t *bits, size_t max_bits) {
+    uint8_t raw[128];
+    size_t n = 0;
+    bool ext = (frame->id & CAN_ID_EXT) != 0;
+    bool rtr = (frame->id & CAN_ID_RTR) != 0;
+    uint32_t id = frame->id & CAN_ID_MASK;
+    uint8_t dlc = frame->dlc > 15 ? 15 : frame->dlc;
+
+    n = put_bits(raw, n, 0, 1); // SOF
+    if (ext) {
+        n = put_bits(raw, n, id >> 18, 11);
+        n = put_bits(raw, n, 1, 1); // SRR
+        n = put_bits(raw, n, 1, 1); // IDE
+        n = put_bits(raw, n, id & 0x3FFFF, 18);
+        n = put_bits(raw, n, rtr, 1);
+        n = put_bits(raw, n, 0, 2); // r1, r0
+    } else {
+        n = put_bits(raw, n, id & 0x7FF, 11);
+        n = put_bits(raw, n, rtr, 1);
+        n = put_bits(raw, n, 0, 2); // IDE, r0
+    }
+    n = put_bits(raw, n, dlc, 4);
+    for (size_t i = 0; i < data_len(rtr, dlc); i++) n = put_bits(raw, n, frame->data[i], 8);
+
+    uint16_t crc = 0;
+    for (size_t i = 0; i < n; i++) crc = crc15_bit(crc, raw[i]);
+    n = put_bits(raw, n, crc, 15);
+
+    size_t out = 0;
+    uint8_t last = 2;
+    int run = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (out + 2 > max_bits) return 0;
+        bits[out++] = raw[i];
+        if (raw[i] == last) {
+            run++;
+        } else {
+            last = raw[i];
+            run = 1;
+        }
+        if (run == 5) {
+            last = !last;
+            bits[out++] = last;
+            run = 1;
+        }
+    }
+
+    // Delimitador de CRC, ACK (dominante), delimitador de ACK, EOF 7 e intervalo 3
+    static const uint8_t trailer[] = { 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    if (out + sizeof(trailer) > max_bits) return 0;
+    memcpy(&bits[out], trailer, sizeof(trailer));
+    return out + sizeof(trailer);
+}
@@ -0,0 +1,95 @@
+/**
+ * @file can_decoder.h
+ * @brief Decodificador de CAN 2.0 a partir dos bits amostrados do barramento, sem depender do Pico SDK
+ *
+ * Recebe os bits crus como o programa PIO can_rx.pio os amostra (palavras de
+ * 32 bits, primeiro bit no MSB, 1 = recessivo) e faz em software o que um
+ * controlador CAN faria em modo só escuta: detecção de SOF depois do
+ * barramento livre, remoção dos bits de stuffing, campos de quadro padrão
+ * (11 bits) e estendido (29 bits), CRC-15 e delimitadores. Nunca transmite:
+ * não dá ACK nem quadro de erro, então pode ficar pendurado no barramento do
+ * carro sem mudar nada nele.
+ *
+ * Quadros válidos vão para on_frame; os sinais de interesse saem deles com
+ * can_signal_decode(), numa tabela no formato do DBC (bit inicial Intel,
+ * tamanho, fator) que converte direto para o inteiro do fio de channels.csv.
+ *
+ * O mesmo código roda na IRQ do PIO (can_rx.c) e no bench de Linux que
+ * reproduz logs gravados (bench/bench_can_decode.c); can_encode_frame() gera
+ * o trem de bits de um quadro para o bench e para o benchmark por RPC.
+ */
+
+#ifndef CAN_DECODER_H
+#define CAN_DECODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAN_ID_EXT         0x80000000u // Marca de quadro estendido em can_frame_t.id
+#define CAN_ID_RTR         0x40000000u // Marca de quadro remoto
+#define CAN_ID_MASK        0x1FFFFFFFu
+#define CAN_IDLE_BITS      10          // Recessivos seguidos antes de aceitar um SOF
+#define CAN_MAX_FRAME_BITS 160         // Quadro estendido de 8 bytes com stuffing, ACK, EOF e intervalo
+
+typedef struct {
+    uint32_t id;     // 11 ou 29 bits, mais CAN_ID_EXT / CAN_ID_RTR
+    uint8_t dlc;
+    uint8_t data[8];
+} can_frame_t;
+
+typedef struct {
+    uint32_t bits;           // Bits amostrados (inclui barramento livre)
+    uint32_t frames;         // Quadros com CRC e delimitadores corretos
+    uint32_t frames_acked;   // ...com o bit de ACK dominante (alguma ECU confirmou)
+    uint32_t stuff_errors;   // Seis bits iguais dentro do quadro
+    uint32_t crc_errors;
+    uint32_t form_errors;    // Delimitador de CRC ou de ACK dominante
+} can_decoder_stats_t;
+
+typedef void (*can_frame_fn)(void *ctx, const can_frame_t *frame);
+
+typedef struct {
+    can_frame_fn on_frame;
+    void *ctx;
+
+    uint8_t state;
+    uint8_t last_bit;        // Para o stuffing
+    uint8_t run_len;
+    uint8_t trailer_pos;
+    uint32_t idle_run;       // Recessivos seguidos fora de quadro
+    uint16_t nbits;          // Bits de quadro (sem stuffing) desde o SOF
+    uint16_t crc_start;      // Primeiro bit do CRC; 0 enquanto o DLC não chegou
+    uint16_t crc;
+    uint8_t raw[16];         // Bits de quadro, primeiro no MSB de raw[0]
+    bool acked;
+
+    can_decoder_stats_t stats;
+} can_decoder_t;
+
+// Sinal de um quadro, como no DBC: valor_do_fio = bruto * mul / div + offset
+typedef struct {
+    uint32_t id;             // Com CAN_ID_EXT se estendido
+    uint8_t slot;            // channel_slot_t de channels.csv
+    uint8_t start_bit;       // Little-endian (Intel), numeração do DBC
+    uint8_t length;
+    bool is_signed;
+    int32_t mul;
+    int32_t div;
+    int32_t offset;
+} can_signal_t;
+
+void can_decoder_init(can_decoder_t *dec, can_frame_fn on_frame, void *ctx);
+
+// Uma palavra do FIFO do PIO: 32 bits, o mais antigo no MSB
+void can_decoder_feed_word(can_decoder_t *dec, uint32_t word);
+void can_decoder_feed_bit(can_decoder_t *dec, uint8_t bit);
+
+// Extrai o sinal se o quadro for dele e tiver bytes suficientes
+bool can_signal_decode(const can_signal_t *sig, const can_frame_t *frame, int32_t *wire_value);
+
+// Trem de bits do quadro como aparece no barramento (um bit por byte): SOF até
+// o fim do intervalo entre quadros, com stuffing e ACK dominante. Retorna quantos bits.
+size_t can_encode_frame(const can_frame_t *frame, uint8_t *bits, size_t max_bits);
+
+#endif // CAN_DECODER_H
@@ -0,0 +1,90 @@
+/**
+ * @file can_rx.c
+ * @brief Implementação do receptor CAN passivo (ver can_rx.h)
+ */
+
+#include "can_rx.h"
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+#include "can_rx.pio.h"
+
+#define RING_MASK (CAN_RX_RING_SIZE - 1)
+
+static uint sm_can;
+static can_decoder_t decoder;
+static const can_signal_t *signal_table;
+static size_t signal_count;
+
+static can_rx_frame_t ring[CAN_RX_RING_SIZE];
+static volatile uint32_t ring_head; // Escrito pela IRQ
+static volatile uint32_t ring_tail; // Escrito pelo núcleo 1
+static volatile uint32_t matched;
+static volatile uint32_t ring_dropped;
+static volatile uint32_t fifo_overruns;
+
+static void on_frame(void *ctx, const can_frame_t *frame) {
+    (void)ctx;
+
+    size_t i = 0;
+    while (i < signal_count && signal_table[i].id != frame->id) i++;
+    if (i == signal_count) return; // Quadro de outra ECU que não interessa
+    matched++;
+
+    uint32_t head = ring_head;
+    if (head - ring_tail >= CAN_RX_RING_SIZE) {
+        ring_dropped++;
+        return;
+    }
+    ring[head & RING_MASK].frame = *frame;
+    ring[head & RING_MASK].t_us = time_us_32();
+    __dmb(); // Quadro visível antes do head
+    ring_head = head + 1;
+    __sev();
+}
+
+static void can_rx_irq(void) {
+    const uint32_t stall_mask = 1u << (PIO_FDEBUG_RXSTALL_LSB + sm_can);
+
+    while (!pio_sm_is_rx_fifo_empty(CAN_RX_PIO, sm_can)) {
+        can_decoder_feed_word(&decoder, pio_sm_get(CAN_RX_PIO, sm_can));
+    }
+    if (CAN_RX_PIO->fdebug & stall_mask) {
+        fifo_overruns++;
+        CAN_RX_PIO->fdebug = stall_mask; // Limpa escrevendo 1
+    }
+}
+
+void can_rx_init(const can_signal_t *signals, size_t count) {
+    signal_table = signals;
+    signal_count = count;
+    ring_head = ring_tail = 0;
+    can_decoder_init(&decoder, on_frame, NULL);
+
+    uint offset = pio_add_program(CAN_RX_PIO, &can_rx_program);
+    sm_can = pio_claim_unused_sm(CAN_RX_PIO, true);
+    can_rx_program_init(CAN_RX_PIO, sm_can, offset, CAN_RX_PIN, CAN_RX_BITRATE);
+
+    irq_set_exclusive_handler(CAN_RX_PIO_IRQ, can_rx_irq);
+    pio_set_irq1_source_enabled(CAN_RX_PIO, (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + sm_can), true);
+    irq_set_enabled(CAN_RX_PIO_IRQ, true);
+}
+
+bool can_rx_pop(can_rx_frame_t *out) {
+    uint32_t tail = ring_tail;
+    if (tail == ring_head) return false;
+
+    __dmb(); // Lê o quadro depois do head
+    *out = ring[tail & RING_MASK];
+    __dmb(); // Cópia concluída antes de liberar o slot
+    ring_tail = tail + 1;
+    return true;
+}
+
+void can_rx_get_stats(can_rx_stats_t *out) {
+    out->decoder = decoder.stats;
+    out->matched = matched;
+    out->ring_dropped = ring_dropped;
+    out->fifo_overruns = fifo_overruns;
+}
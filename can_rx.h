@@ -0,0 +1,49 @@
+/**
+ * @file can_rx.h
+ * @brief Receptor CAN passivo no PIO0 (programa can_rx.pio + can_decoder)
+ *
+ * Um transceiver (ex. SN65HVD230, 3,3 V) ligado no barramento do carro
+ * entrega o nível do CAN_L/CAN_H em CAN_RX_PIN; o TX do transceiver fica
+ * desligado, nada é transmitido. Uma state machine livre do PIO0 (a outra é
+ * dos LEDs) amostra os bits e a IRQ do FIFO de recepção roda o decodificador.
+ *
+ * Só os quadros cujo ID aparece na tabela de sinais passam pelo ring para o
+ * núcleo 1, com o instante em que terminaram; o resto só conta nas
+ * estatísticas. Cada quadro aceito dá __sev(), então o núcleo 1 dorme em
+ * __wfe() entre eles. Tudo roda no núcleo 1 (IRQ e consumidor do ring).
+ */
+
+#ifndef CAN_RX_H
+#define CAN_RX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "can_decoder.h"
+
+#define CAN_RX_PIO       pio0
+#define CAN_RX_PIO_IRQ   PIO0_IRQ_1
+#define CAN_RX_PIN       8
+#define CAN_RX_BITRATE   500000      // Barramento de powertrain
+#define CAN_RX_RING_SIZE 32          // Quadros; potência de 2
+
+typedef struct {
+    can_frame_t frame;
+    uint32_t t_us;
+} can_rx_frame_t;
+
+typedef struct {
+    can_decoder_stats_t decoder;
+    uint32_t matched;        // Quadros com ID da tabela de sinais
+    uint32_t ring_dropped;   // Núcleo 1 atrasado; o quadro é descartado
+    uint32_t fifo_overruns;  // FIFO do PIO cheio: bits perdidos, o quadro em curso vira erro
+} can_rx_stats_t;
+
+// Núcleo 1. A tabela tem que viver enquanto o receptor roda.
+void can_rx_init(const can_signal_t *signals, size_t count);
+bool can_rx_pop(can_rx_frame_t *out);
+
+// Cópia campo a campo; pode ser chamada do núcleo 0
+void can_rx_get_stats(can_rx_stats_t *out);
+
+#endif // CAN_RX_H
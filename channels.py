@@ -0,0 +1,33 @@
+"""Gerado por gen_channels.py a partir de channels.csv - não edite à mão."""
+
+from collections import namedtuple
+
+Channel = namedtuple("Channel", "name tag slot sweep unit decimals scale offset deadband")
+
+CHANNELS = (
+    Channel('rpm', 1, 0, 0, 'rpm', 0, 1.0, 0, 10),
+    Channel('speed', 3, 1, 1, 'km/h', 0, 1.0, 0, 0),
+    Channel('iat', 2, 2, 2, 'C', 0, 1.0, 0, 0),
+    Channel('fuel_rate', 4, 3, 3, 'L/h', 2, 1.0, 0, 5),
+    Channel('coolant', 5, 4, 4, 'C', 0, 1.0, 0, 0),
+    Channel('timing', 6, 5, 5, 'graus', 1, 1.0, 0, 5),
+    Channel('afr', 7, 6, 6, '', 2, 1.0, 0, 5),
+)
+
+BY_NAME = {c.name: c for c in CHANNELS}
+BY_TAG = {c.tag: c for c in CHANNELS}
+SWEEP = tuple(sorted((c for c in CHANNELS if c.sweep >= 0), key=lambda c: c.sweep))
+
+TAG_RPM = 1
+TAG_SPEED = 3
+TAG_IAT = 2
+TAG_FUEL_RATE = 4
+TAG_COOLANT = 5
+TAG_TIMING = 6
+TAG_AFR = 7
+
+
+def to_wire(channel, value):
+    """Converte o valor físico no inteiro enviado no fio para este canal."""
+    fixed = value * 10 ** channel.decimals
+    return int(round((fixed - channel.offset) / channel.scale))
@@ -0,0 +1,45 @@
+/**
+ * @file cpu_load.c
+ * @brief Contagem do tempo ocioso por núcleo (ver cpu_load.h)
+ */
+
+#include "cpu_load.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+static volatile uint32_t idle_total[2];
+static volatile uint32_t idle_start[2];
+static volatile bool idle_now[2];
+
+void cpu_idle_begin(void) {
+    unsigned core = get_core_num();
+
+    TRACE_BEGIN(TRACE_IDLE, 0);
+    idle_start[core] = time_us_32();
+    __dmb();
+    idle_now[core] = true;
+}
+
+void cpu_idle_end(void) {
+    unsigned core = get_core_num();
+
+    idle_total[core] += time_us_32() - idle_start[core];
+    __dmb();
+    idle_now[core] = false;
+    TRACE_END(TRACE_IDLE, 0);
+}
+
+uint32_t cpu_idle_us(unsigned core) {
+    if (core > 1) return 0;
+    // Sem lock: bem na hora de acordar a leitura pode contar um sono duas
+    // vezes; cpu_busy_pct() limita o resultado e a janela seguinte corrige
+    uint32_t total = idle_total[core];
+    if (idle_now[core]) total += time_us_32() - idle_start[core];
+    return total;
+}
+
+uint32_t cpu_busy_pct(uint32_t idle_delta_us, uint32_t elapsed_us) {
+    if (elapsed_us == 0 || idle_delta_us >= elapsed_us) return 0;
+    return (uint32_t)(100 - (uint64_t)idle_delta_us * 100 / elapsed_us);
+}
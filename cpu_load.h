@@ -0,0 +1,27 @@
+/**
+ * @file cpu_load.h
+ * @brief Ocupação de cada núcleo pela conta do tempo dormindo em __wfe()
+ *
+ * Os dois núcleos dormem só em pontos conhecidos (core0_wait_events e a
+ * espera do loop do núcleo 1); cpu_idle_begin/end em volta deles somam o
+ * tempo ocioso por núcleo. Ocupação numa janela = 1 - ocioso / duração.
+ * IRQs atendidas durante o sono contam como ociosas, o que é pouco perto
+ * do resto. As mesmas chamadas marcam TRACE_IDLE no trace.h.
+ */
+
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+#include <stdint.h>
+
+// Núcleo atual vai dormir / acordou
+void cpu_idle_begin(void);
+void cpu_idle_end(void);
+
+// Tempo ocioso acumulado do núcleo em us, incluindo o sono em andamento (use diferenças)
+uint32_t cpu_idle_us(unsigned core);
+
+// Ocupação em % entre duas leituras de cpu_idle_us() separadas por elapsed_us
+uint32_t cpu_busy_pct(uint32_t idle_delta_us, uint32_t elapsed_us);
+
+#endif // CPU_LOAD_H
@@ -0,0 +1,411 @@
+/**
+ * @file elm327.c
+ * @brief Implementação do cliente ELM327 (ver elm327.h)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "elm327.h"
+
+// Mesmas constantes do cálculo de consumo do get_rpm.py
+#define ENGINE_DISPLACEMENT_L    1.0f   // Cilindrada (1.0 para o Up TSI)
+#define VOLUMETRIC_EFFICIENCY    0.90f
+#define AIR_FUEL_RATIO           14.7f
+#define GASOLINE_DENSITY_G_PER_L 750.0f
+
+#define RESET_HOLD_US 200000 // Depois de um timeout, espera o adaptador parar antes do ATZ
+
+typedef struct {
+    uint8_t pid;
+    uint8_t bytes;  // Bytes de dados na resposta
+    uint8_t slot;
+} elm327_pid_t;
+
+static const elm327_pid_t pid_table[] = {
+    { 0x0C, 2, CH_RPM },
+    { 0x0D, 1, CH_SPEED },
+    { 0x0F, 1, CH_IAT },
+    { 0x0B, 1, CH_FUEL_RATE },  // MAP; vira consumo com RPM e IAT
+    { 0x05, 1, CH_COOLANT },
+    { 0x0E, 1, CH_TIMING },
+    { 0x44, 2, CH_AFR },
+};
+#define PID_COUNT (sizeof(pid_table) / sizeof(pid_table[0]))
+
+static const char *const config_commands[] = { "ATE0", "ATL0", "ATS0", "ATH0", "ATAT2", "ATSP0" };
+#define CONFIG_COUNT (sizeof(config_commands) / sizeof(config_commands[0]))
+
+// Linhas de texto que o adaptador manda durante a busca de protocolo e que não são erro
+static const char *const ignored_lines[] = { "SEARCHING", "BUS INIT" };
+
+static const elm327_pid_t *find_pid(uint8_t pid) {
+    for (size_t i = 0; i < PID_COUNT; i++) {
+        if (pid_table[i].pid == pid) return &pid_table[i];
+    }
+    return NULL;
+}
+
+static const elm327_pid_t *find_slot(uint8_t slot) {
+    for (size_t i = 0; i < PID_COUNT; i++) {
+        if (pid_table[i].slot == slot) return &pid_table[i];
+    }
+    return NULL;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static void send_command(elm327_t *elm, const char *cmd, uint32_t now_us) {
+    char buf[24];
+    int n = snprintf(buf, sizeof(buf), "%s\r", cmd);
+
+    elm->resp_len = 0;
+    elm->resp_expected = -1;
+    elm->resp_no_data = false;
+    elm->resp_error = false;
+    elm->reply[0] = '\0';
+    strncpy(elm->command, cmd, sizeof(elm->command) - 1);
+    elm->line_len = 0;
+    elm->line_overflow = false;
+    elm->busy = true;
+    elm->sent_us = now_us;
+    elm->write(elm->ctx, buf, (size_t)n);
+}
+
+static void start_reset(elm327_t *elm, uint32_t now_us) {
+    elm->state = ELM327_RESETTING;
+    elm->step = 0;
+    elm->max_batch = 1;
+    elm->response_count = true;
+    elm->inflight_count = 0;
+    memset(elm->no_data_count, 0, sizeof(elm->no_data_count));
+    send_command(elm, "ATZ", now_us);
+}
+
+void elm327_init(elm327_t *elm, elm327_write_fn write, elm327_value_fn on_value, void *ctx, uint32_t now_us) {
+    memset(elm, 0, sizeof(*elm));
+    elm->write = write;
+    elm->on_value = on_value;
+    elm->ctx = ctx;
+    elm->iat_c = 25;
+    for (int slot = 0; slot < CH_COUNT; slot++) elm->next_due_us[slot] = now_us;
+    start_reset(elm, now_us);
+}
+
+void elm327_set_rate(elm327_t *elm, channel_slot_t slot, uint16_t rate_chz) {
+    if (slot < CH_COUNT) elm->rate_chz[slot] = rate_chz;
+}
+
+// Monta o próximo pedido com os canais vencidos de prazo mais antigo
+static void dispatch(elm327_t *elm, uint32_t now_us) {
+    char cmd[2 + 2 * ELM327_MAX_BATCH + 2] = "01";
+    size_t len = 2;
+
+    elm->inflight_count = 0;
+    while (elm->inflight_count < elm->max_batch) {
+        int best = -1;
+        uint16_t best_rate = 0; // Lida uma vez: o divisor abaixo é o mesmo valor testado aqui
+        for (int slot = 0; slot < CH_COUNT; slot++) {
+            bool taken = false;
+            uint16_t rate = elm->rate_chz[slot];
+            for (int i = 0; i < elm->inflight_count; i++) taken |= elm->inflight[i] == slot;
+            if (taken || rate == 0 || elm->no_data_count[slot] >= ELM327_NO_DATA_LIMIT) continue;
+            if (find_slot(slot) == NULL || (int32_t)(elm->next_due_us[slot] - now_us) > 0) continue;
+            if (best < 0 || (int32_t)(elm->next_due_us[slot] - elm->next_due_us[best]) < 0) {
+                best = slot;
+                best_rate = rate;
+            }
+        }
+        if (best < 0) break;
+
+        static const char hex[] = "0123456789ABCDEF";
+        uint8_t pid = find_slot(best)->pid;
+        cmd[len++] = hex[pid >> 4];
+        cmd[len++] = hex[pid & 0x0F];
+        elm->inflight[elm->inflight_count++] = (uint8_t)best;
+
+        // Mantém a taxa média; se o adaptador não dá conta, o prazo não corre atrás do atraso
+        uint32_t next = elm->next_due_us[best] + 100000000u / best_rate;
+        elm->next_due_us[best] = (int32_t)(next - now_us) < 0 ? now_us : next;
+    }
+    if (elm->inflight_count == 0) return;
+
+    if (elm->response_count) cmd[len++] = '1';
+    cmd[len] = '\0';
+    elm->stats.requests++;
+    send_command(elm, cmd, now_us);
+}
+
+uint8_t elm327_decode_pid(elm327_t *elm, uint8_t pid, const uint8_t *data, int32_t *wire_value) {
+    int32_t a = data[0];
+    int32_t ab = 0; // Só PIDs de 2 bytes leem data[1]
+
+    if (pid == 0x0C || pid == 0x44) ab = (data[0] << 8) | data[1];
+
+    switch (pid) {
+        case 0x0C: // ((A*256)+B)/4 rpm
+            elm->rpm_x4 = ab;
+            *wire_value = (ab + 2) >> 2;
+            return CH_RPM;
+        case 0x0D: // A km/h
+            *wire_value = a;
+            return CH_SPEED;
+        case 0x0F: // A-40 °C
+            elm->iat_c = a - 40;
+            *wire_value = a - 40;
+            return CH_IAT;
+        case 0x05: // A-40 °C
+            *wire_value = a - 40;
+            return CH_COOLANT;
+        case 0x0E: // A/2-64 graus, 1 casa decimal
+            *wire_value = a * 5 - 640;
+            return CH_TIMING;
+        case 0x44: // (A*256+B)/32768 x 14.7, 2 casas decimais
+            *wire_value = (ab * 1470 + 16384) >> 15;
+            return CH_AFR;
+        case 0x0B: { // MAP em kPa -> consumo em L/h (speed-density), 2 casas decimais
+            float air_g = a * ENGINE_DISPLACEMENT_L * VOLUMETRIC_EFFICIENCY * 1000.0f / (287.05f * (elm->iat_c + 273.15f));
+            float maf_g_per_s = air_g * (elm->rpm_x4 / 4.0f) / 120.0f;
+            float lph = maf_g_per_s / AIR_FUEL_RATIO / GASOLINE_DENSITY_G_PER_L * 3600.0f;
+            *wire_value = (int32_t)(lph * 100.0f + 0.5f);
+            return CH_FUEL_RATE;
+        }
+    }
+    return CH_NONE;
+}
+
+// Resposta de modo 01: "41 pid dados [pid dados...]", possivelmente de várias ECUs
+static void decode_response(elm327_t *elm, const uint8_t *resp, size_t len,
+                            const uint8_t *inflight, uint8_t inflight_count, bool no_data, uint32_t t_us) {
+    uint32_t answered = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        if (resp[i] == 0x41) { i++; continue; } // Cabeçalho de cada mensagem
+        const elm327_pid_t *p = find_pid(resp[i]);
+        if (p == NULL || i + 1 + p->bytes > len) {
+            elm->stats.errors++; // Sem o tamanho do PID não dá para seguir
+            break;
+        }
+        int32_t value;
+        uint8_t slot = elm327_decode_pid(elm, p->pid, &resp[i + 1], &value);
+        elm->on_value(elm->ctx, channel_info[slot].tag, value, t_us);
+        elm->stats.values++;
+        answered |= 1u << slot;
+        i += 1 + p->bytes;
+    }
+
+    if (answered) elm->stats.responses++;
+    if (no_data) elm->stats.no_data++;
+    for (int k = 0; k < inflight_count; k++) {
+        uint8_t slot = inflight[k];
+        if (answered & (1u << slot)) {
+            elm->no_data_count[slot] = 0;
+        } else if (elm->no_data_count[slot] < ELM327_NO_DATA_LIMIT) {
+            elm->no_data_count[slot]++;
+        }
+    }
+}
+
+static void on_prompt(elm327_t *elm, uint32_t now_us) {
+    if (!elm->busy) return; // Prompt da inicialização do adaptador ou depois de um STOPPED
+    elm->busy = false;
+
+    uint32_t latency = now_us - elm->sent_us;
+    elm->stats.last_latency_us = latency;
+    if (latency > elm->stats.max_latency_us) elm->stats.max_latency_us = latency;
+    elm->stats.total_latency_us += latency;
+
+    switch (elm->state) {
+        case ELM327_RESETTING:
+            elm->state = ELM327_CONFIGURING;
+            elm->step = 0;
+            send_command(elm, config_commands[0], now_us);
+            break;
+
+        case ELM327_CONFIGURING:
+            // Clones às vezes respondem "?" a ATAT2; segue sem ele
+            if (strcmp(elm->reply, "OK") != 0) elm->stats.errors++;
+            if (++elm->step < CONFIG_COUNT) {
+                send_command(elm, config_commands[elm->step], now_us);
+            } else {
+                elm->state = ELM327_SEARCHING;
+                elm->step = 0;
+                send_command(elm, "0100", now_us);
+            }
+            break;
+
+        case ELM327_SEARCHING:
+            if (elm->step == 0) {
+                // Ignição desligada responde UNABLE TO CONNECT; tenta de novo no próximo poll
+                if (elm->resp_len > 0 && elm->resp[0] == 0x41) {
+                    elm->step = 1;
+                    send_command(elm, "ATDPN", now_us);
+                }
+            } else {
+                const char *p = elm->reply[0] == 'A' ? elm->reply + 1 : elm->reply;
+                int protocol = hex_digit(p[0]);
+                elm->max_batch = (protocol >= 6 && protocol <= 9) ? ELM327_MAX_BATCH : 1;
+                elm->state = ELM327_POLLING;
+                dispatch(elm, now_us);
+            }
+            break;
+
+        case ELM327_POLLING: {
+            // Copia a resposta e já escreve o próximo pedido: o adaptador vai para o
+            // barramento enquanto esta resposta é decodificada
+            uint8_t resp[ELM327_RESP_MAX];
+            uint8_t inflight[ELM327_MAX_BATCH];
+            uint8_t inflight_count = elm->inflight_count;
+            size_t len = elm->resp_len;
+            bool no_data = elm->resp_no_data;
+
+            if (elm->resp_expected >= 0 && (size_t)elm->resp_expected < len) len = (size_t)elm->resp_expected;
+            if (elm->resp_error) {
+                elm->stats.errors++;
+                if (elm->response_count && strcmp(elm->reply, "?") == 0) elm->response_count = false;
+            }
+            memcpy(resp, elm->resp, len);
+            memcpy(inflight, elm->inflight, inflight_count);
+
+            dispatch(elm, now_us);
+            decode_response(elm, resp, len, inflight, inflight_count, no_data, now_us);
+            break;
+        }
+    }
+}
+
+static void process_line(elm327_t *elm) {
+    const char *line = elm->line;
+    if (elm->line_len == 0 || strcmp(line, elm->command) == 0) return; // Eco
+
+    if (elm->reply[0] == '\0') {
+        strncpy(elm->reply, line, sizeof(elm->reply) - 1);
+        elm->reply[sizeof(elm->reply) - 1] = '\0';
+    }
+    if (elm->line_overflow) {
+        elm->resp_error = true;
+        return;
+    }
+    for (size_t i = 0; i < sizeof(ignored_lines) / sizeof(ignored_lines[0]); i++) {
+        if (strncmp(line, ignored_lines[i], strlen(ignored_lines[i])) == 0) return;
+    }
+    if (strncmp(line, "NO DATA", 7) == 0) {
+        elm->resp_no_data = true;
+        return;
+    }
+    if (elm->state < ELM327_SEARCHING) return; // Respostas de AT ficam só em reply
+
+    // Multi-quadro do CAN: "00E" (bytes no total) e depois "0:...", "1:..."
+    const char *p = line;
+    const char *colon = strchr(line, ':');
+    if (colon != NULL) p = colon + 1;
+
+    int digits = 0;
+    int value = 0;
+    uint8_t bytes[ELM327_LINE_MAX / 2];
+    size_t count = 0;
+    for (; *p; p++) {
+        if (*p == ' ') continue;
+        int d = hex_digit(*p);
+        if (d < 0) {
+            elm->resp_error = true; // "?", CAN ERROR, STOPPED, ...
+            return;
+        }
+        value = (value << 4) | d;
+        if (++digits % 2 == 0) {
+            bytes[count++] = (uint8_t)value;
+            value = 0;
+        }
+    }
+    if (colon == NULL && digits == 3) {
+        elm->resp_expected = (bytes[0] << 4) | value;
+        return;
+    }
+    if (digits % 2 != 0 || elm->resp_len + count > ELM327_RESP_MAX) {
+        elm->resp_error = true;
+        return;
+    }
+    memcpy(elm->resp + elm->resp_len, bytes, count);
+    elm->resp_len += count;
+}
+
+void elm327_feed(elm327_t *elm, const uint8_t *data, size_t len, uint32_t now_us) {
+    if (elm->hold_until_us) return; // Restos do comando abortado
+
+    for (size_t i = 0; i < len; i++) {
+        char c = (char)data[i];
+        if (c == '>') {
+            on_prompt(elm, now_us);
+        } else if (c == '\r' || c == '\n') {
+            elm->line[elm->line_len] = '\0';
+            process_line(elm);
+            elm->line_len = 0;
+            elm->line_overflow = false;
+        } else if (c != '\0') {
+            if (elm->line_len < ELM327_LINE_MAX - 1) {
+                elm->line[elm->line_len++] = c;
+            } else {
+                elm->line_overflow = true;
+            }
+        }
+    }
+}
+
+void elm327_poll(elm327_t *elm, uint32_t now_us) {
+    if (elm->hold_until_us) {
+        if ((int32_t)(now_us - elm->hold_until_us) < 0) return;
+        elm->hold_until_us = 0;
+        elm->stats.resets++;
+        start_reset(elm, now_us);
+        return;
+    }
+
+    if (elm->busy) {
+        uint32_t timeout = elm->state == ELM327_POLLING ? ELM327_TIMEOUT_US : ELM327_RESET_TIMEOUT_US;
+        if (now_us - elm->sent_us > timeout) {
+            // Um byte qualquer interrompe o adaptador; o que ele ainda mandar é descartado
+            elm->stats.timeouts++;
+            elm->busy = false;
+            elm->write(elm->ctx, "\r", 1);
+            elm->hold_until_us = (now_us + RESET_HOLD_US) | 1;
+        }
+        return;
+    }
+
+    if (elm->state == ELM327_POLLING) {
+        dispatch(elm, now_us);
+    } else if (elm->state == ELM327_SEARCHING && elm->step == 0 && now_us - elm->sent_us > ELM327_TIMEOUT_US) {
+        send_command(elm, "0100", now_us);
+    }
+}
+
+// Distância até o instante t, 0 se já passou
+static uint32_t until(uint32_t t, uint32_t now_us) {
+    return (int32_t)(t - now_us) > 0 ? t - now_us : 0;
+}
+
+uint32_t elm327_next_poll_us(const elm327_t *elm, uint32_t now_us) {
+    if (elm->hold_until_us) return until(elm->hold_until_us, now_us);
+
+    if (elm->busy) {
+        uint32_t timeout = elm->state == ELM327_POLLING ? ELM327_TIMEOUT_US : ELM327_RESET_TIMEOUT_US;
+        return until(elm->sent_us + timeout + 1, now_us);
+    }
+
+    if (elm->state == ELM327_SEARCHING && elm->step == 0) return until(elm->sent_us + ELM327_TIMEOUT_US + 1, now_us);
+    if (elm->state != ELM327_POLLING) return UINT32_MAX;
+
+    // Mesmo critério de dispatch(): o canal elegível de prazo mais próximo
+    uint32_t wait = UINT32_MAX;
+    for (int slot = 0; slot < CH_COUNT; slot++) {
+        if (elm->rate_chz[slot] == 0 || elm->no_data_count[slot] >= ELM327_NO_DATA_LIMIT || find_slot(slot) == NULL) continue;
+        uint32_t u = until(elm->next_due_us[slot], now_us);
+        if (u < wait) wait = u;
+    }
+    return wait;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file elm327.h
+ * @brief Cliente ELM327 (comandos AT + OBD-II modo 01) sem depender do Pico SDK
+ *
+ * Substitui o get_rpm.py como ponte: o núcleo 1 conversa direto com o
+ * adaptador pela UART (ver elm327_uart.h) e entrega os canais já convertidos
+ * para o inteiro do fio de channels.csv, com as mesmas fórmulas do script.
+ *
+ * Sequência: ATZ, ATE0, ATL0, ATS0, ATH0, ATAT2, ATSP0, depois "0100" (força
+ * a busca de protocolo) e ATDPN. Em protocolo CAN (6..9) um pedido leva até
+ * ELM327_MAX_BATCH PIDs ("010C0D0F..."); nos demais, um PID por pedido.
+ *
+ * Pipeline: o ELM327 só aceita um comando por vez (um byte a mais aborta o
+ * pedido em andamento), então o próximo pedido é escrito no instante em que
+ * chega o prompt '>' e a resposta anterior é decodificada depois, enquanto o
+ * adaptador já está no barramento. O sufixo de quantidade de respostas
+ * ("010C1") evita que o adaptador espere o timeout por outras ECUs; se o
+ * adaptador responder "?" a ele, o sufixo é desligado.
+ *
+ * Quais PIDs pedir vem da taxa de cada canal (elm327_set_rate, a mesma
+ * assinatura por tela que vai para o get_rpm.py): cada pedido leva os canais
+ * de prazo mais antigo que já venceram. PID que responde NO DATA
+ * ELM327_NO_DATA_LIMIT vezes seguidas deixa de ser pedido até o próximo reset.
+ *
+ * Tempo sempre vem de fora (now_us), para o mesmo código rodar no Pico e no
+ * bench de Linux contra o simulador elm327_sim.py.
+ */
+
+#ifndef ELM327_H
+#define ELM327_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "channel_table.h"
+
+#define ELM327_MAX_BATCH      6    // PIDs por pedido no CAN (limite do ISO 15765-4)
+#define ELM327_LINE_MAX       48
+#define ELM327_RESP_MAX       48   // Bytes de dados de uma resposta (multi-quadro incluso)
+#define ELM327_TIMEOUT_US     1000000  // Sem prompt depois disso: reset do adaptador
+#define ELM327_RESET_TIMEOUT_US 10000000 // ATZ e busca de protocolo são lentos
+#define ELM327_NO_DATA_LIMIT  3
+
+typedef void (*elm327_write_fn)(void *ctx, const char *data, size_t len);
+typedef void (*elm327_value_fn)(void *ctx, uint8_t tag, int32_t wire_value, uint32_t t_us);
+
+typedef enum {
+    ELM327_RESETTING = 0,  // Esperando o prompt do ATZ
+    ELM327_CONFIGURING,    // Comandos AT de configuração
+    ELM327_SEARCHING,      // "0100" e ATDPN
+    ELM327_POLLING,
+} elm327_state_t;
+
+typedef struct {
+    uint32_t requests;
+    uint32_t responses;        // Pedidos com pelo menos um PID decodificado
+    uint32_t values;           // Canais entregues a on_value
+    uint32_t no_data;
+    uint32_t errors;           // "?", CAN ERROR, resposta malformada...
+    uint32_t timeouts;
+    uint32_t resets;
+    uint32_t last_latency_us;  // Pedido escrito -> prompt
+    uint32_t max_latency_us;
+    uint64_t total_latency_us;
+} elm327_stats_t;
+
+typedef struct {
+    elm327_write_fn write;
+    elm327_value_fn on_value;
+    void *ctx;
+
+    elm327_state_t state;
+    uint8_t step;              // Comando atual de CONFIGURING/SEARCHING
+    bool busy;                 // Comando escrito, prompt ainda não chegou
+    uint32_t sent_us;
+    uint32_t hold_until_us;    // != 0: descartando a saída de um comando abortado até este instante
+    char command[20];          // Último comando, para ignorar o eco antes do ATE0
+    uint8_t max_batch;         // 1 fora do CAN
+    bool response_count;       // Sufixo "1" nos pedidos
+
+    uint8_t inflight[ELM327_MAX_BATCH]; // Slots do pedido em andamento
+    uint8_t inflight_count;
+
+    char line[ELM327_LINE_MAX];
+    size_t line_len;
+    bool line_overflow;
+    uint8_t resp[ELM327_RESP_MAX];
+    size_t resp_len;
+    int resp_expected;         // Contagem de bytes do multi-quadro (-1 sem)
+    bool resp_no_data;
+    bool resp_error;
+    char reply[12];            // Primeira linha de texto (OK, A6, ELM327...)
+
+    // Escrito com elm327_set_rate, sempre pelo dono do cliente
+    uint16_t rate_chz[CH_COUNT];
+    uint32_t next_due_us[CH_COUNT];
+    uint8_t no_data_count[CH_COUNT];
+
+    // Últimos valores físicos usados no cálculo de consumo (MAP -> L/h)
+    int32_t rpm_x4;
+    int32_t iat_c;
+
+    elm327_stats_t stats;
+} elm327_t;
+
+void elm327_init(elm327_t *elm, elm327_write_fn write, elm327_value_fn on_value, void *ctx, uint32_t now_us);
+
+// Taxa desejada do canal em centi-Hz; 0 = não pedir
+void elm327_set_rate(elm327_t *elm, channel_slot_t slot, uint16_t rate_chz);
+
+// Bytes recebidos do adaptador; pode chamar write e on_value
+void elm327_feed(elm327_t *elm, const uint8_t *data, size_t len, uint32_t now_us);
+
+// Timeouts e pedidos que venceram com o adaptador ocioso
+void elm327_poll(elm327_t *elm, uint32_t now_us);
+
+// us até elm327_poll() ter algo a fazer (0 = já); UINT32_MAX se só bytes do adaptador
+// mudam o estado. Entre um e outro o dono do cliente pode dormir.
+uint32_t elm327_next_poll_us(const elm327_t *elm, uint32_t now_us);
+
+// Decodifica a resposta de um PID de modo 01 para o valor do fio de channels.csv.
+// Retorna o slot (CH_NONE se o PID não é de um canal) e atualiza o contexto de consumo.
+uint8_t elm327_decode_pid(elm327_t *elm, uint8_t pid, const uint8_t *data, int32_t *wire_value);
+
+#endif // ELM327_H
@@ -0,0 +1,237 @@
+"""Simulador de adaptador ELM327 num pseudo-terminal, para testar o cliente nativo (elm327.c) sem carro.
+
+Abre um pty, imprime o caminho do lado escravo e responde como um ELM327 v1.5
+ligado num carro CAN (protocolo 6): comandos AT de configuração, modo 01 com
+até 6 PIDs por pedido (respostas multi-quadro como o adaptador formata) e o
+sufixo de quantidade de respostas. O carro sintético sobe e desce de RPM e
+velocidade em ciclos, com os mesmos PIDs que o get_rpm.py lê.
+
+Tempo de resposta: --latency-ms por pedido (barramento + adaptador), mais
+--wait-ms quando o pedido não traz o sufixo "1" (o ELM espera outras ECUs).
+--baud atrasa cada byte como numa UART de verdade. Um byte recebido enquanto
+o pedido está em andamento o interrompe ("STOPPED"), como no adaptador.
+
+Exemplos:
+    python elm327_sim.py                          # imprime /dev/pts/N
+    python elm327_sim.py --latency-ms 40 --baud 38400
+    ./bench_elm327 /dev/pts/N 10                  # bench/bench_elm327.c
+"""
+
+import argparse
+import math
+import os
+import select
+import time
+import tty
+
+VERSION = "ELM327 v1.5"
+PROTOCOL = 6  # ISO 15765-4 CAN 11 bits, 500 kbaud
+
+# PID -> número de bytes de dados
+SUPPORTED_PIDS = {0x00: 4, 0x05: 1, 0x0B: 1, 0x0C: 2, 0x0D: 1, 0x0E: 1, 0x0F: 1, 0x20: 4, 0x40: 4, 0x44: 2}
+
+
+def supported_bitmap(base):
+    bits = 0
+    for pid in SUPPORTED_PIDS:
+        if base < pid <= base + 0x20:
+            bits |= 1 << (32 - (pid - base))
+    return list(bits.to_bytes(4, "big"))
+
+
+def car_state(t):
+    """Carro sintético: ciclo de 20 s acelerando até ~120 km/h e voltando."""
+    phase = (t % 20.0) / 20.0
+    speed = 120 * math.sin(math.pi * phase)
+    gear_rpm = 1500 + (speed % 30) / 30 * 4500
+    return {
+        "rpm": gear_rpm if speed > 5 else 850,
+        "speed": speed,
+        "iat": 35 + 5 * phase,
+        "coolant": 90,
+        "map": 30 + 70 * max(0.0, math.cos(math.pi * phase)),
+        "timing": 10 + 20 * phase,
+        "afr": 14.7 if speed > 5 else 14.2,
+    }
+
+
+def pid_data(pid, car):
+    if pid == 0x00:
+        return supported_bitmap(0x00)
+    if pid == 0x20:
+        return supported_bitmap(0x20)
+    if pid == 0x40:
+        return supported_bitmap(0x40)
+    if pid == 0x0C:
+        v = int(car["rpm"] * 4)
+        return [v >> 8, v & 0xFF]
+    if pid == 0x0D:
+        return [int(car["speed"])]
+    if pid == 0x0F:
+        return [int(car["iat"]) + 40]
+    if pid == 0x05:
+        return [int(car["coolant"]) + 40]
+    if pid == 0x0B:
+        return [int(car["map"])]
+    if pid == 0x0E:
+        return [int((car["timing"] + 64) * 2)]
+    if pid == 0x44:
+        v = int(car["afr"] / 14.7 * 32768)
+        return [v >> 8, v & 0xFF]
+    return None
+
+
+class Elm327Sim:
+    def __init__(self, fd, latency_ms, wait_ms, baud):
+        self.fd = fd
+        self.latency = latency_ms / 1000
+        self.wait = wait_ms / 1000
+        self.byte_time = 10 / baud if baud else 0.0
+        self.t0 = time.monotonic()
+        self.buf = bytearray()
+        self.requests = 0
+        self.stopped = 0
+        self.reset()
+
+    def reset(self):
+        self.echo = True
+        self.linefeeds = True
+        self.spaces = True
+        self.headers = False
+        self.searching = True  # ATSP0: a primeira requisição OBD mostra SEARCHING...
+
+    def write(self, text):
+        data = text.replace("\r", "\r\n" if self.linefeeds else "\r").encode()
+        for i in range(0, len(data), 16):
+            os.write(self.fd, data[i:i + 16])
+            if self.byte_time:
+                time.sleep(self.byte_time * 16)
+
+    def busy_wait(self, seconds):
+        """Dorme o tempo de barramento; False se chegou um byte (pedido interrompido)."""
+        ready, _, _ = select.select([self.fd], [], [], seconds)
+        return not ready
+
+    def fmt(self, data):
+        return (" " if self.spaces else "").join(f"{b:02X}" for b in data)
+
+    def obd_reply(self, data):
+        """Formata uma resposta de modo 01 como o ELM faz no CAN (multi-quadro acima de 7 bytes)."""
+        if len(data) <= 7:
+            return self.fmt(data) + "\r"
+        lines = [f"{len(data):03X}\r"]
+        chunks = [data[:6]] + [data[i:i + 7] for i in range(6, len(data), 7)]
+        for n, chunk in enumerate(chunks):
+            chunk = chunk + [0x00] * ((6 if n == 0 else 7) - len(chunk))
+            lines.append(f"{n % 16:X}:{' ' if self.spaces else ''}{self.fmt(chunk)}\r")
+        return "".join(lines)
+
+    def handle_at(self, cmd):
+        arg = cmd[2:]
+        if arg in ("Z", "WS"):
+            time.sleep(0.5 if arg == "Z" else 0.1)
+            self.reset()
+            return f"\r{VERSION}\r"
+        if arg == "I":
+            return VERSION + "\r"
+        if arg in ("E0", "E1"):
+            self.echo = arg == "E1"
+        elif arg in ("L0", "L1"):
+            self.linefeeds = arg == "L1"
+        elif arg in ("S0", "S1"):
+            self.spaces = arg == "S1"
+        elif arg in ("H0", "H1"):
+            self.headers = arg == "H1"
+        elif arg == "DPN":
+            return f"A{PROTOCOL}\r"
+        elif arg == "DP":
+            return "AUTO, ISO 15765-4 (CAN 11/500)\r"
+        elif arg == "RV":
+            return "14.2V\r"
+        elif arg.startswith(("SP", "TP", "AT", "ST", "D", "M0", "CAF")):
+            pass
+        else:
+            return "?\r"
+        return "OK\r"
+
+    def handle_obd(self, cmd):
+        if len(cmd) < 4 or any(c not in "0123456789ABCDEF" for c in cmd):
+            return "?\r"
+        count_hint = len(cmd) % 2 == 1
+        if count_hint:
+            cmd = cmd[:-1]
+        mode = int(cmd[:2], 16)
+        pids = [int(cmd[i:i + 2], 16) for i in range(2, len(cmd), 2)]
+        if mode != 0x01 or len(pids) > 6:
+            return "?\r"
+
+        self.requests += 1
+        prefix = ""
+        if self.searching:
+            self.searching = False
+            prefix = "SEARCHING...\r"
+        if not self.busy_wait(self.latency + (0 if count_hint else self.wait)):
+            self.stopped += 1
+            return None
+
+        car = car_state(time.monotonic() - self.t0)
+        data = [0x41]
+        for pid in pids:
+            value = pid_data(pid, car) if pid in SUPPORTED_PIDS else None
+            if value is not None:
+                data += [pid] + value
+        if len(data) == 1:
+            return prefix + "NO DATA\r"
+        return prefix + self.obd_reply(data)
+
+    def handle(self, line):
+        raw = line.decode(errors="replace")
+        cmd = raw.replace(" ", "").upper()
+        if self.echo:
+            self.write(raw + "\r")
+        if not cmd:
+            return
+        reply = self.handle_at(cmd) if cmd.startswith("AT") else self.handle_obd(cmd)
+        if reply is None:
+            self.buf.clear()
+            self.write("STOPPED\r\r>")
+            return
+        self.write(reply + "\r>")
+
+    def run(self):
+        while True:
+            select.select([self.fd], [], [])
+            try:
+                data = os.read(self.fd, 256)
+            except OSError:
+                time.sleep(0.1)  # Lado escravo fechado; espera o próximo cliente
+                continue
+            for byte in data:
+                if byte == 0x0D:
+                    line = bytes(self.buf)
+                    self.buf.clear()
+                    self.handle(line)
+                elif byte != 0x0A:
+                    self.buf.append(byte)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--latency-ms", type=float, default=30.0, help="tempo de barramento por pedido")
+    parser.add_argument("--wait-ms", type=float, default=50.0, help="espera extra sem o sufixo de respostas")
+    parser.add_argument("--baud", type=int, default=0, help="simula a UART (0 = sem atraso por byte)")
+    args = parser.parse_args()
+
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    print(f"ELM327 simulado em {os.ttyname(slave)} (Ctrl+C para sair)", flush=True)
+
+    sim = Elm327Sim(master, args.latency_ms, args.wait_ms, args.baud)
+    try:
+        sim.run()
+    except KeyboardInterrupt:
+        print(f"\n{sim.requests} pedidos OBD, {sim.stopped} interrompidos")
+
+
+if __name__ == "__main__":
+    main()
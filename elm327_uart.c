@@ -0,0 +1,70 @@
+/**
+ * @file elm327_uart.c
+ * @brief Implementação da UART do ELM327 (ver elm327_uart.h)
+ */
+
+#include "elm327_uart.h"
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/uart.h"
+
+#define RING_MASK (ELM327_UART_RING_SIZE - 1)
+
+static uint8_t ring[ELM327_UART_RING_SIZE];
+static volatile uint32_t ring_head; // Escrito pela IRQ
+static volatile uint32_t ring_tail; // Escrito pelo núcleo 1
+static volatile uint32_t overruns;
+
+static void elm327_uart_irq(void) {
+    bool wake = false;
+
+    while (uart_is_readable(ELM327_UART)) {
+        uint8_t c = (uint8_t)uart_getc(ELM327_UART);
+        uint32_t head = ring_head;
+        if (head - ring_tail >= ELM327_UART_RING_SIZE) {
+            overruns++; // O cliente percebe a resposta truncada e conta como erro
+            continue;
+        }
+        ring[head & RING_MASK] = c;
+        __dmb(); // Byte visível antes do novo head
+        ring_head = head + 1;
+        if (c == '>' || c == '\r') wake = true;
+    }
+    if (wake) __sev();
+}
+
+void elm327_uart_init(void) {
+    uart_init(ELM327_UART, ELM327_UART_BAUD);
+    gpio_set_function(ELM327_UART_TX_PIN, GPIO_FUNC_UART);
+    gpio_set_function(ELM327_UART_RX_PIN, GPIO_FUNC_UART);
+    uart_set_fifo_enabled(ELM327_UART, true);
+
+    ring_head = ring_tail = 0;
+    irq_set_exclusive_handler(ELM327_UART_IRQ, elm327_uart_irq);
+    irq_set_enabled(ELM327_UART_IRQ, true);
+    uart_set_irq_enables(ELM327_UART, true, false);
+}
+
+size_t elm327_uart_read(uint8_t *dst, size_t max) {
+    uint32_t tail = ring_tail;
+    uint32_t avail = ring_head - tail;
+    size_t n = avail < max ? avail : max;
+
+    __dmb(); // Lê os dados depois do head
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = ring[(tail + i) & RING_MASK];
+    }
+    __dmb(); // Leitura concluída antes de liberar o espaço
+    ring_tail = tail + n;
+    return n;
+}
+
+void elm327_uart_write(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    uart_write_blocking(ELM327_UART, (const uint8_t *)data, len);
+}
+
+uint32_t elm327_uart_overruns(void) {
+    return overruns;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file elm327_uart.h
+ * @brief UART do adaptador ELM327 para o cliente nativo (ver elm327.h)
+ *
+ * A IRQ de recepção copia os bytes do FIFO da UART para um ring e dá __sev()
+ * a cada fim de linha ou prompt '>', então o núcleo 1 pode dormir em __wfe()
+ * entre respostas. As escritas são comandos curtos, que cabem no FIFO de
+ * transmissão (32 bytes) sem esperar.
+ *
+ * Tudo roda no núcleo 1: a IRQ é registrada no núcleo que chama
+ * elm327_uart_init() e o ring tem um único consumidor.
+ */
+
+#ifndef ELM327_UART_H
+#define ELM327_UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ELM327_UART           uart0
+#define ELM327_UART_IRQ       UART0_IRQ
+#define ELM327_UART_TX_PIN    0
+#define ELM327_UART_RX_PIN    1
+#define ELM327_UART_BAUD      38400 // Padrão do ELM327 (pinos de configuração em alto)
+#define ELM327_UART_RING_SIZE 256   // Potência de 2
+
+void elm327_uart_init(void); // Núcleo 1
+size_t elm327_uart_read(uint8_t *dst, size_t max);
+void elm327_uart_write(void *ctx, const char *data, size_t len); // elm327_write_fn
+
+uint32_t elm327_uart_overruns(void);
+
+#endif // ELM327_UART_H
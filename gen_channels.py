@@ -0,0 +1,209 @@
+"""Gera a tabela de canais do firmware e o módulo Python a partir de channels.csv.
+
+Uso:
+    python gen_channels.py [--spec channels.csv] [--c-out DIR] [--py-out channels.py]
+    python gen_channels.py --c-out DIR --check-py channels.py
+
+Sem argumentos, escreve channel_table.h/.c e channels.py ao lado deste script;
+é assim que se regenera o channels.py depois de mudar channels.csv.
+O CMake chama este script no build (ver CMakeLists.txt) com --check-py: gera
+só a tabela C e falha se o channels.py versionado estiver desatualizado, sem
+escrever na árvore de fontes.
+"""
+
+import argparse
+import csv
+import os
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+HEADER = "Gerado por gen_channels.py a partir de channels.csv - não edite à mão."
+
+
+def load_spec(path):
+    with open(path, encoding="utf-8") as f:
+        rows = [line for line in f if line.strip() and not line.lstrip().startswith("#")]
+    channels = []
+    for slot, row in enumerate(csv.DictReader(rows)):
+        ch = {
+            "name": row["name"].strip(),
+            "tag": int(row["tag"]),
+            "sweep": int(row["sweep"]),
+            "unit": row["unit"].strip(),
+            "decimals": int(row["decimals"]),
+            "scale": float(row["scale"]),
+            "offset": int(row["offset"]),
+            "deadband": int(row.get("deadband") or 0),
+            "slot": slot,
+        }
+        ch["scale_q16"] = int(round(ch["scale"] * 65536))
+        channels.append(ch)
+    validate(channels)
+    return channels
+
+
+def validate(channels):
+    names, tags, sweeps = set(), set(), set()
+    for ch in channels:
+        if not ch["name"].isidentifier():
+            sys.exit(f"canal '{ch['name']}': nome inválido")
+        if ch["name"] in names:
+            sys.exit(f"canal '{ch['name']}' duplicado")
+        if not 1 <= ch["tag"] <= 254 or ch["tag"] in tags:
+            sys.exit(f"canal '{ch['name']}': tag {ch['tag']} inválida ou repetida")
+        if ch["deadband"] < 0:
+            sys.exit(f"canal '{ch['name']}': banda morta negativa")
+        if ch["sweep"] >= 0 and ch["sweep"] in sweeps:
+            sys.exit(f"canal '{ch['name']}': posição de varredura {ch['sweep']} repetida")
+        names.add(ch["name"])
+        tags.add(ch["tag"])
+        if ch["sweep"] >= 0:
+            sweeps.add(ch["sweep"])
+    if sweeps and sweeps != set(range(len(sweeps))):
+        sys.exit("as posições de varredura precisam ser 0..N-1 sem buracos")
+    if len(sweeps) > 16:
+        sys.exit("no máximo 16 canais na varredura (TP_MAX_CHANNELS / máscara do quadro delta)")
+
+
+def sweep_order(channels):
+    return sorted((c for c in channels if c["sweep"] >= 0), key=lambda c: c["sweep"])
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path, encoding="utf-8") as f:
+            if f.read() == text:
+                return
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+
+
+def gen_c_header(channels):
+    sweep = sweep_order(channels)
+    out = [
+        f"// {HEADER}",
+        "",
+        "#ifndef CHANNEL_TABLE_H",
+        "#define CHANNEL_TABLE_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        f"#define CH_COUNT {len(channels)}",
+        f"#define CH_SWEEP_COUNT {len(sweep)}",
+        "#define CH_NONE 0xFF",
+        "",
+        "typedef enum {",
+    ]
+    out += [f"    CH_{c['name'].upper()} = {c['slot']}," for c in channels]
+    out += [
+        "} channel_slot_t;",
+        "",
+        "typedef struct {",
+        "    const char *name;",
+        "    const char *unit;",
+        "    uint8_t tag;",
+        "    uint8_t decimals;",
+        "    int32_t scale_q16;    // Q16.16 aplicado ao valor do fio",
+        "    int32_t offset;       // Somado após a escala",
+        "    float resolution;     // 10^-decimals, para exibição",
+        "} channel_info_t;",
+        "",
+        "extern const channel_info_t channel_info[CH_COUNT];",
+        "extern const uint8_t channel_slot_by_tag[256];       // CH_NONE = tag desconhecida",
+        "extern const uint8_t channel_sweep_slots[CH_SWEEP_COUNT];",
+        "",
+        "#endif // CHANNEL_TABLE_H",
+        "",
+    ]
+    return "\n".join(out)
+
+
+def gen_c_source(channels):
+    by_tag = ["CH_NONE"] * 256
+    for c in channels:
+        by_tag[c["tag"]] = f"CH_{c['name'].upper()}"
+
+    out = [f"// {HEADER}", "", '#include "channel_table.h"', "",
+           "const channel_info_t channel_info[CH_COUNT] = {"]
+    for c in channels:
+        out.append(
+            f"    [CH_{c['name'].upper()}] = {{ \"{c['name']}\", \"{c['unit']}\", {c['tag']}, {c['decimals']}, "
+            f"{c['scale_q16']}, {c['offset']}, {10.0 ** -c['decimals']!r}f }},"
+        )
+    out += ["};", "", "const uint8_t channel_slot_by_tag[256] = {"]
+    for i in range(0, 256, 8):
+        out.append("    " + ", ".join(by_tag[i:i + 8]) + ",")
+    out += ["};", "", "const uint8_t channel_sweep_slots[CH_SWEEP_COUNT] = {"]
+    out += [f"    CH_{c['name'].upper()}," for c in sweep_order(channels)]
+    out += ["};", ""]
+    return "\n".join(out)
+
+
+def gen_python(channels):
+    out = [
+        f'"""{HEADER}"""',
+        "",
+        "from collections import namedtuple",
+        "",
+        'Channel = namedtuple("Channel", "name tag slot sweep unit decimals scale offset deadband")',
+        "",
+        "CHANNELS = (",
+    ]
+    for c in channels:
+        out.append(
+            f"    Channel({c['name']!r}, {c['tag']}, {c['slot']}, {c['sweep']}, {c['unit']!r}, "
+            f"{c['decimals']}, {c['scale']!r}, {c['offset']}, {c['deadband']}),"
+        )
+    out += [
+        ")",
+        "",
+        "BY_NAME = {c.name: c for c in CHANNELS}",
+        "BY_TAG = {c.tag: c for c in CHANNELS}",
+        "SWEEP = tuple(sorted((c for c in CHANNELS if c.sweep >= 0), key=lambda c: c.sweep))",
+        "",
+    ]
+    out += [f"TAG_{c['name'].upper()} = {c['tag']}" for c in channels]
+    out += [
+        "",
+        "",
+        "def to_wire(channel, value):",
+        '    """Converte o valor físico no inteiro enviado no fio para este canal."""',
+        "    fixed = value * 10 ** channel.decimals",
+        "    return int(round((fixed - channel.offset) / channel.scale))",
+        "",
+    ]
+    return "\n".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--spec", default=os.path.join(HERE, "channels.csv"))
+    parser.add_argument("--c-out", default=HERE, help="diretório de channel_table.h/.c")
+    parser.add_argument("--py-out", default=os.path.join(HERE, "channels.py"))
+    parser.add_argument("--check-py", metavar="PATH",
+                        help="não escreve o módulo Python; só confere se PATH está em dia")
+    args = parser.parse_args()
+
+    channels = load_spec(args.spec)
+
+    # Confere antes de gerar a tabela C: com a verificação falhando, as saídas
+    # do build não ficam em dia e o próximo build confere de novo
+    if args.check_py:
+        try:
+            with open(args.check_py, encoding="utf-8") as f:
+                current = f.read()
+        except OSError:
+            current = None
+        if current != gen_python(channels):
+            sys.exit(f"{args.check_py} desatualizado em relação a {args.spec}: "
+                     f"rode 'python {os.path.basename(__file__)}' e versione o resultado")
+    else:
+        write_if_changed(args.py_out, gen_python(channels))
+
+    os.makedirs(args.c_out, exist_ok=True)
+    write_if_changed(os.path.join(args.c_out, "channel_table.h"), gen_c_header(channels))
+    write_if_changed(os.path.join(args.c_out, "channel_table.c"), gen_c_source(channels))
+
+
+if __name__ == "__main__":
+    main()
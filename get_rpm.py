@@ -3,12 +3,20 @@ import serial
 from bleak import BleakClient
 import csv  
 import datetime 
+import time
+import channels
+from telemetry_proto import (
+    TP_MSG_SWEEP, TP_MSG_STATUS, TP_MSG_PROBE_ECHO, TP_MSG_SUBSCRIBE,
+    encode_frame, encode_varint, encode_delta, decode_status, encode_probe, decode_probe_echo,
+    decode_subscription, PicoLinkReader, SendRateController, DeltaEncoder, LatencyStats,
+    PollScheduler, find_pico_data_port,
+)
 
 DEVICE_ADDRESS = "88:1B:99:67:5B:38"
 UUID_WRITE = "0000fff2-0000-1000-8000-00805f9b34fb"
 UUID_NOTIFY = "0000fff1-0000-1000-8000-00805f9b34fb"
 
-SERIAL_PORT = "COM9"   # IMPORTANTE: Verifique se esta é a porta COM correta no Gerenciador de Dispositivos
+SERIAL_PORT = "COM9"   # Só se a porta de telemetria do Pico não for encontrada automaticamente
 BAUD_RATE = 115200
 
 AIR_FUEL_RATIO = 14.7  # g de ar / g de gasolina
@@ -34,6 +42,7 @@ csv_writer = None
 
 
 try:
+    SERIAL_PORT = find_pico_data_port(SERIAL_PORT)
     ser = serial.Serial(SERIAL_PORT, BAUD_RATE, timeout=1)
     print(f"✅ Serial conectado em {SERIAL_PORT} a {BAUD_RATE} baud")
 except Exception as e:
@@ -51,13 +60,99 @@ def write_log_entry():
             last_iat_celsius,
             round(last_fuel_lph, 2)
         ])
-def send_serial(tag,value):
-    if ser and ser.is_open:
-        try:
-            ser.write(f"{tag},{int(value)}\n".encode())
-            print(f"📤 Enviado via Serial: {f"{int(value)}\n".strip()}")
-        except Exception as e:
-            print(f"❌ Erro ao enviar dados via Serial: {e}")
+
+# --- Protocolo binário (ver telemetry_proto.py / telemetry_proto.h no firmware) ---
+USE_BINARY_PROTOCOL = True   # False volta às linhas de texto "tag,valor"
+HOST_T0 = time.monotonic()
+pico_link = PicoLinkReader()
+# Mensagem descartada na fila de envio: a próxima varredura vai completa
+send_flow = SendRateController(on_drop=lambda: sweep_delta.force_keyframe())
+KEYFRAME_INTERVAL_S = 1.0    # Varredura completa periódica para o Pico ressincronizar
+CHANNEL_MAX_AGE_S = 2.0      # PID sem resposta há mais que isso deixa de ser enviado
+
+# Resposta OBD -> canal de channels.csv, para saber quando cada canal foi lido pela última vez
+PID_CHANNEL = {
+    "41 0C": "rpm",
+    "41 0F": "iat",
+    "41 0D": "speed",
+    "41 0B": "fuel_rate",
+    "41 05": "coolant",
+    "41 0E": "timing",
+    "41 44": "afr",
+}
+channel_updated_at = {}
+CHANNEL_PID = {channel: "01" + pid[3:] + "\r" for pid, channel in PID_CHANNEL.items()}
+
+# Polling guiado pela tela do Pico: ele manda a assinatura (canais + taxa) ao
+# trocar de tela e o próximo PID pedido é sempre o de prazo mais antigo.
+# Até a primeira assinatura todos os canais são lidos no ritmo da varredura fixa antiga.
+DEFAULT_POLL_HZ = {channel: 3.0 for channel in PID_CHANNEL.values()}
+PID_GAP_S = {"iat": 0.1, "fuel_rate": 0.1}  # Espera após o pedido antes do próximo; padrão 0.02 s
+poll_scheduler = PollScheduler(DEFAULT_POLL_HZ)
+
+# Sonda de latência: a cada resposta de RPM manda o valor logo em seguida num
+# quadro de sonda, e o Pico devolve quanto tempo levou até os LEDs e o display
+LATENCY_PROBE = False
+LATENCY_REPORT_S = 10.0
+latency = LatencyStats()
+probe_seq = 0
+last_latency_report = time.monotonic()
+sweep_delta = DeltaEncoder(channels.SWEEP, KEYFRAME_INTERVAL_S)
+
+
+def host_timestamp_ms():
+    return int((time.monotonic() - HOST_T0) * 1000) & 0x7FFFFFFF
+
+
+def send_sweep():
+    """Envia a última varredura OBD numa única mensagem.
+
+    Timestamp do host seguido dos canais na ordem de varredura de channels.csv,
+    já convertidos para o inteiro do fio (casas decimais/escala da tabela).
+    Entre keyframes só vão os canais que saíram da banda morta (quadro delta);
+    se nenhum mudou, nada é enviado. Canais cujo PID não responde há mais de
+    CHANNEL_MAX_AGE_S ficam de fora, para o Pico perceber que envelheceram.
+    """
+    physical = {
+        "rpm": last_rpm,
+        "speed": last_speed,
+        "iat": last_iat_celsius,
+        "fuel_rate": last_fuel_lph,
+        "coolant": last_coolant_temp,
+        "timing": last_timing_advance,
+        "afr": last_commanded_afr,
+    }
+    if not (ser and ser.is_open):
+        sweep_delta.force_keyframe()
+        return
+    now = time.monotonic()
+    update = sweep_delta.update([
+        channels.to_wire(c, physical[c.name])
+        if now - channel_updated_at.get(c.name, float("-inf")) <= CHANNEL_MAX_AGE_S else None
+        for c in channels.SWEEP
+    ])
+    if update is None:
+        return
+    ts = host_timestamp_ms()
+    try:
+        if update[0] == "keyframe":
+            values = [ts] + update[1]
+            if USE_BINARY_PROTOCOL:
+                send_flow.submit(encode_frame(TP_MSG_SWEEP, b"".join(encode_varint(v) for v in values)))
+            else:
+                send_flow.submit(("S," + ",".join(str(v) for v in values) + "\n").encode())
+        else:
+            _, mask, changed = update
+            values = [ts, mask] + changed
+            if USE_BINARY_PROTOCOL:
+                send_flow.submit(encode_delta(ts, mask, changed))
+            else:
+                send_flow.submit(("D," + ",".join(str(v) for v in values) + "\n").encode())
+        send_flow.flush_if_due(ser)
+        print(f"📤 {'Keyframe' if update[0] == 'keyframe' else 'Delta'} enviado via Serial: {values}")
+    except Exception as e:
+        sweep_delta.force_keyframe()
+        print(f"❌ Erro ao enviar dados via Serial: {e}")
 
 
 async def read_obd_data(client, command):
@@ -72,7 +167,6 @@ def parse_rpm(response_str):
             rpm = ((int(parts[2], 16) * 256) + int(parts[3], 16)) / 4
             print(f"🚗 RPM: {int(rpm)} RPM")
             last_rpm=rpm
-            send_serial(1,rpm)
     except Exception as e:
         print(f"⚠️ Erro ao processar RPM: {e}")
 
@@ -85,7 +179,6 @@ def parse_air_intake_temp(response_str):
             temp = int(parts[2], 16) - 40
             print(f"🌡️ Temp. Admissão: {temp}°C")
             last_iat_celsius = temp
-            send_serial(2,temp)
     except Exception as e:
         print(f"⚠️ Erro ao processar IAT: {e}")
 
@@ -98,7 +191,6 @@ def parse_vehicle_speed(response_str):
             speed = int(parts[2], 16)
             last_speed = speed
             print(f"🛞 Velocidade: {speed} km/h")
-            send_serial(3, speed)
     except Exception as e:
         print(f"⚠️ Erro ao processar VSS: {e}")
 
@@ -127,8 +219,6 @@ def parse_map_and_calc_fuel(response_str):
 
             print(f"💧 Consumo (MAP): {fuel_l_per_hour:.2f} L/h")
             last_fuel_lph = fuel_l_per_hour
-            value_to_send = int(fuel_l_per_hour * 100)
-            send_serial(4, value_to_send)
     except Exception as e:
         print(f"⚠️ Erro ao processar MAP/Consumo: {e}")
 
@@ -163,7 +253,6 @@ def parse_commanded_afr(response_str):
             afr = ratio * 14.7
             print(f"⛽ AFR Comandado: {afr:.2f}:1")
             last_commanded_afr = afr
-            # send_serial(7, afr)
     except Exception as e:
         print(f"⚠️ Erro ao processar AFR Comandado: {e}")
 
@@ -192,43 +281,77 @@ def notification_handler(sender, data):
     elif response_str.startswith("41 44"): ## NEW
         parse_commanded_afr(response_str)
 
+    channel = PID_CHANNEL.get(response_str[:5])
+    if channel:
+        channel_updated_at[channel] = time.monotonic()
+        if LATENCY_PROBE and channel == "rpm":
+            send_latency_probe(channel_updated_at[channel])
+
+
+def send_latency_probe(notified_at):
+    """Escreve direto na serial (sem a fila do SendRateController) para medir só o caminho até o Pico."""
+    global probe_seq
+    if not (USE_BINARY_PROTOCOL and ser and ser.is_open):
+        return
+    probe_seq += 1
+    now = time.monotonic()
+    try:
+        ser.write(encode_probe(probe_seq, int((now - notified_at) * 1e6),
+                               [(channels.TAG_RPM, channels.to_wire(channels.BY_TAG[channels.TAG_RPM], last_rpm))]))
+        latency.on_send(probe_seq)
+    except Exception as e:
+        print(f"❌ Erro ao enviar sonda de latência: {e}")
+
+
+def handle_subscription(payload):
+    rates = {channels.BY_TAG[tag].name: hz for tag, hz in decode_subscription(payload).items()
+             if tag in channels.BY_TAG and channels.BY_TAG[tag].name in CHANNEL_PID}
+    if poll_scheduler.subscribe(rates):
+        print(f"📋 Nova assinatura do Pico: {rates}")
+
+
+def handle_pico_line(pico_command):
+    if pico_command == "START_LOG":
+        start_datalogging()
+    elif pico_command == "STOP_LOG":
+        stop_datalogging()
+
 
 async def main_loop(client):
+    global last_latency_report
     monitoring_active = True 
     while client.is_connected:
         if ser and ser.in_waiting > 0:
             try:
-                pico_command = ser.readline().decode('utf-8').strip()
-                if pico_command == "START_LOG":
-                    start_datalogging()
-                elif pico_command == "STOP_LOG":
-                    stop_datalogging()
-
+                for kind, data in pico_link.feed(ser.read(ser.in_waiting)):
+                    if kind == "line":
+                        handle_pico_line(data)
+                    elif data[0] == TP_MSG_STATUS:
+                        send_flow.on_status(decode_status(data))
+                    elif data[0] == TP_MSG_PROBE_ECHO:
+                        latency.on_echo(decode_probe_echo(data))
+                    elif data[0] == TP_MSG_SUBSCRIBE:
+                        handle_subscription(data)
             except Exception as e:
                 print(f"Erro ao ler comando do Pico: {e}")
+        if ser and ser.is_open:
+            send_flow.flush_if_due(ser)
+        if LATENCY_PROBE and time.monotonic() - last_latency_report >= LATENCY_REPORT_S:
+            last_latency_report = time.monotonic()
+            print("⏱️ Latência notificação OBD -> Pico:\n" + latency.report(histogram=False))
         if monitoring_active:
-
-            await read_obd_data(client, "010C\r")
-            await asyncio.sleep(0.02)  
-
-            await read_obd_data(client, "010F\r")
-            await asyncio.sleep(0.1)
-            await read_obd_data(client, "010D\r")
-            await asyncio.sleep(0.02)
-                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                 
-            await read_obd_data(client, "010B\r")
-            await asyncio.sleep(0.1)
-
-            await read_obd_data(client, "0105\r") 
-            await asyncio.sleep(0.02)
-                
-            await read_obd_data(client, "010E\r") 
-            await asyncio.sleep(0.02)
-
-            await read_obd_data(client, "0144\r") 
-            await asyncio.sleep(0.02)
-
-
+            channel, wait = poll_scheduler.next_channel()
+            if channel is None or wait > 0:
+                # Nada vencido: volta logo para atender o Pico em vez de dormir o prazo inteiro
+                await asyncio.sleep(min(wait, 0.02) if channel else 0.05)
+                continue
+
+            await read_obd_data(client, CHANNEL_PID[channel])
+            poll_scheduler.polled(channel)
+            await asyncio.sleep(PID_GAP_S.get(channel, 0.02))
+
+            # Só os canais que mudaram vão ao Pico (quadro delta), então dá para enviar a cada PID
+            send_sweep()
             write_log_entry()
 
 def start_datalogging():
@@ -0,0 +1,197 @@
+/**
+ * @file input.c
+ * @brief ADC em round-robin por DMA, botão por IRQ e a fila de eventos (ver input.h)
+ */
+
+#include "input.h"
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+#define ADC_CLOCK_HZ     48000000
+#define ADC_FIRST_GPIO   26 // GP26..GP29 = entradas 0..3 do ADC
+
+_Static_assert(INPUT_ADC_BLOCK % 2 == 0, "cada bloco do DMA precisa começar no mesmo eixo");
+
+static volatile uint8_t queue[INPUT_QUEUE_SIZE];
+static volatile uint32_t queue_head;  // Escrito só pelas IRQs
+static volatile uint32_t queue_tail;  // Escrito só pelo loop principal
+static volatile uint32_t dropped;
+
+// Joystick: o round-robin lê a entrada de número menor primeiro, então as
+// posições pares do bloco são dela
+static int dma_chan;
+static uint adc_first_input;
+static bool x_is_first;
+static uint16_t adc_block[INPUT_ADC_BLOCK];
+static volatile uint16_t axis_x = 2048, axis_y = 2048;
+
+// Botão
+static uint sw;
+static bool pressed, long_fired;
+static alarm_id_t long_press_alarm;
+static uint32_t last_edge_us;
+
+static void push(input_event_t ev) {
+    uint32_t irq = save_and_disable_interrupts();
+    if (queue_head - queue_tail < INPUT_QUEUE_SIZE) {
+        queue[queue_head & INPUT_QUEUE_MASK] = (uint8_t)ev;
+        queue_head = queue_head + 1;
+    } else {
+        dropped = dropped + 1;
+    }
+    restore_interrupts(irq);
+    TRACE_INSTANT(TRACE_INPUT, ev);
+}
+
+bool input_pop(input_event_t *out) {
+    if (queue_tail == queue_head) return false;
+    *out = (input_event_t)queue[queue_tail & INPUT_QUEUE_MASK];
+    queue_tail = queue_tail + 1;
+    return true;
+}
+
+bool input_pending(void) {
+    return queue_tail != queue_head;
+}
+
+void input_joystick(uint16_t *x, uint16_t *y) {
+    *x = axis_x;
+    *y = axis_y;
+}
+
+uint32_t input_dropped(void) {
+    return dropped;
+}
+
+// Eixo Y -> INPUT_UP/INPUT_DOWN, com histerese e repetição enquanto segurado
+static void axis_update(uint16_t y, uint32_t now) {
+    static int dir = 0; // -1, 0, +1
+    static uint32_t next_repeat_us;
+    int d;
+
+    if (y > INPUT_AXIS_HIGH || (dir > 0 && y > INPUT_AXIS_HIGH - INPUT_AXIS_HYSTERESIS)) d = 1;
+    else if (y < INPUT_AXIS_LOW || (dir < 0 && y < INPUT_AXIS_LOW + INPUT_AXIS_HYSTERESIS)) d = -1;
+    else d = 0;
+
+    if (d != dir) {
+        dir = d;
+        if (d) {
+            push(d > 0 ? INPUT_UP : INPUT_DOWN);
+            next_repeat_us = now + INPUT_REPEAT_DELAY_US;
+        }
+    } else if (d && (int32_t)(now - next_repeat_us) >= 0) {
+        push(d > 0 ? INPUT_UP : INPUT_DOWN);
+        next_repeat_us += INPUT_REPEAT_US;
+    }
+}
+
+// Fim de um bloco do DMA: média dos eixos, rearma e gera eventos
+static void dma_irq(void) {
+    if (!dma_channel_get_irq1_status(dma_chan)) return;
+    dma_channel_acknowledge_irq1(dma_chan);
+
+    // Antes de rearmar: o FIFO de 4 amostras do ADC segura ~4 ms enquanto isso
+    uint32_t sum[2] = { 0, 0 };
+    for (int i = 0; i < INPUT_ADC_BLOCK; i++) sum[i & 1] += adc_block[i];
+    uint16_t first = (uint16_t)(sum[0] / (INPUT_ADC_BLOCK / 2));
+    uint16_t second = (uint16_t)(sum[1] / (INPUT_ADC_BLOCK / 2));
+    axis_x = x_is_first ? first : second;
+    axis_y = x_is_first ? second : first;
+
+    // FIFO transbordou (IRQ atrasada demais): uma amostra perdida trocaria os
+    // eixos de posição, então recomeça o round-robin do primeiro
+    if (adc_hw->fcs & ADC_FCS_OVER_BITS) {
+        adc_run(false);
+        while (!(adc_hw->cs & ADC_CS_READY_BITS)) tight_loop_contents();
+        adc_fifo_drain();
+        adc_hw->fcs |= ADC_FCS_OVER_BITS | ADC_FCS_UNDER_BITS; // Limpa escrevendo 1
+        adc_select_input(adc_first_input);
+        adc_run(true);
+    }
+    dma_channel_transfer_to_buffer_now(dma_chan, adc_block, INPUT_ADC_BLOCK);
+
+    axis_update(axis_y, time_us_32());
+}
+
+// Segurou até INPUT_LONG_PRESS_US
+static int64_t long_press_cb(alarm_id_t id, void *user_data) {
+    (void)id;
+    (void)user_data;
+    long_press_alarm = 0;
+    if (!pressed) return 0;
+    if (gpio_get(sw)) {
+        // Soltura engolida pelo debounce (toque rápido): conta como clique
+        pressed = false;
+        push(INPUT_CLICK);
+    } else {
+        long_fired = true;
+        push(INPUT_LONG_PRESS);
+    }
+    return 0;
+}
+
+// Borda aceita só depois de INPUT_DEBOUNCE_US sem nenhuma borda; a
+// trepidação do aperto e da soltura cai dentro da janela e é ignorada
+static void sw_irq(uint gpio, uint32_t events) {
+    uint32_t now = time_us_32();
+
+    if (gpio != sw) return;
+    bool settled = now - last_edge_us > INPUT_DEBOUNCE_US;
+    last_edge_us = now;
+    if (!settled) return;
+
+    // As duas bordas juntas (IRQ atendida atrasada): vale o nível atual
+    bool fall = events & GPIO_IRQ_EDGE_FALL, rise = events & GPIO_IRQ_EDGE_RISE;
+    bool down = fall && rise ? !gpio_get(sw) : fall;
+
+    if (down && !pressed) {
+        pressed = true;
+        long_fired = false;
+        long_press_alarm = add_alarm_in_us(INPUT_LONG_PRESS_US, long_press_cb, NULL, true);
+    } else if (!down && pressed) {
+        pressed = false;
+        if (long_press_alarm > 0) cancel_alarm(long_press_alarm);
+        long_press_alarm = 0;
+        if (!long_fired) push(INPUT_CLICK);
+    }
+}
+
+void input_init(unsigned sw_pin, unsigned x_pin, unsigned y_pin) {
+    uint x_input = x_pin - ADC_FIRST_GPIO, y_input = y_pin - ADC_FIRST_GPIO;
+
+    sw = sw_pin;
+    gpio_init(sw);
+    gpio_set_dir(sw, GPIO_IN);
+    gpio_pull_up(sw);
+    gpio_set_irq_enabled_with_callback(sw, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, sw_irq);
+
+    adc_init();
+    adc_gpio_init(x_pin);
+    adc_gpio_init(y_pin);
+    x_is_first = x_input < y_input;
+    adc_first_input = x_is_first ? x_input : y_input;
+    adc_select_input(adc_first_input);
+    adc_set_round_robin((1u << x_input) | (1u << y_input));
+    adc_fifo_setup(true, true, 1, false, false); // FIFO com DREQ a cada amostra, 12 bits em 16
+    adc_set_clkdiv(ADC_CLOCK_HZ / INPUT_ADC_RATE_HZ - 1);
+
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, DREQ_ADC);
+    dma_channel_configure(dma_chan, &c, adc_block, &adc_hw->fifo, INPUT_ADC_BLOCK, false);
+
+    dma_channel_set_irq1_enabled(dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_1, dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    dma_channel_start(dma_chan);
+    adc_run(true);
+}
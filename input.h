@@ -0,0 +1,63 @@
+/**
+ * @file input.h
+ * @brief Joystick e botão por IRQ/DMA, entregues como fila de eventos ao núcleo 0
+ *
+ * Joystick: o ADC roda sozinho em round-robin nos dois eixos a
+ * INPUT_ADC_RATE_HZ amostras/s e um canal de DMA copia o FIFO para um
+ * buffer de INPUT_ADC_BLOCK amostras. A IRQ de fim do bloco (a cada
+ * 20 ms) rearma o DMA, tira a média de cada eixo e transforma a posição do
+ * eixo Y em eventos: INPUT_UP/INPUT_DOWN ao sair do centro e, com o eixo
+ * parado fora do centro, repetição depois de INPUT_REPEAT_DELAY_US a cada
+ * INPUT_REPEAT_US. Os limiares têm histerese para o ruído do ADC não gerar
+ * eventos na borda.
+ *
+ * Botão: IRQ do GPIO nas duas bordas com debounce por tempo (bordas a menos
+ * de INPUT_DEBOUNCE_US da anterior são trepidação). Soltar antes de
+ * INPUT_LONG_PRESS_US dá INPUT_CLICK; segurar até lá dispara
+ * INPUT_LONG_PRESS na hora, por um alarme, e a soltura não gera clique.
+ *
+ * Os eventos vêm de IRQs do núcleo 0 e vão para uma fila de
+ * INPUT_QUEUE_SIZE; o loop principal só consome (input_pop). Fila cheia
+ * descarta o evento novo e conta em input_dropped(). A saída da IRQ acorda
+ * o __wfe() do loop, que antecipa a tarefa de entrada quando
+ * input_pending().
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define INPUT_QUEUE_SIZE       16      // Potência de 2
+#define INPUT_ADC_RATE_HZ      1000    // Soma dos dois eixos
+#define INPUT_ADC_BLOCK        20      // Amostras por IRQ do DMA (par: metade de cada eixo)
+#define INPUT_AXIS_HIGH        3000    // Fora do centro acima disso...
+#define INPUT_AXIS_LOW         1000    // ...ou abaixo disso (ADC de 12 bits)
+#define INPUT_AXIS_HYSTERESIS  200     // Volta ao centro só depois de passar o limiar por essa folga
+#define INPUT_REPEAT_DELAY_US  300000
+#define INPUT_REPEAT_US        150000
+#define INPUT_DEBOUNCE_US      20000
+#define INPUT_LONG_PRESS_US    800000
+
+typedef enum {
+    INPUT_NONE = 0,
+    INPUT_UP,          // Eixo Y acima de INPUT_AXIS_HIGH
+    INPUT_DOWN,        // Eixo Y abaixo de INPUT_AXIS_LOW
+    INPUT_CLICK,
+    INPUT_LONG_PRESS,
+} input_event_t;
+
+// Núcleo 0: configura ADC, DMA, GPIO do botão e as IRQs (nesse núcleo)
+void input_init(unsigned sw_pin, unsigned x_pin, unsigned y_pin);
+
+// Próximo evento; false com a fila vazia
+bool input_pop(input_event_t *out);
+bool input_pending(void);
+
+// Última média de cada eixo (0..4095)
+void input_joystick(uint16_t *x, uint16_t *y);
+
+uint32_t input_dropped(void);
+
+#endif // INPUT_H
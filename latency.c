@@ -0,0 +1,94 @@
+/**
+ * @file latency.c
+ * @brief Implementação da sonda de latência (ver latency.h)
+ */
+
+#include "latency.h"
+#include "telemetry_proto.h"
+#include "usb_link.h"
+#include "hardware/sync.h"
+
+typedef struct {
+    uint32_t seq;
+    uint32_t obd_age_us;
+    uint32_t t_parsed;
+    uint32_t t_applied;
+} probe_stamp_t;
+
+// Slot núcleo 1 -> núcleo 0; posted muda por último e é relido para detectar sobrescrita
+static probe_stamp_t posted_stamp;
+static volatile uint32_t posted;     // Sondas publicadas pelo núcleo 1
+static volatile uint32_t dropped;
+
+// Estado do núcleo 0
+typedef enum { PROBE_IDLE, PROBE_WAIT_LED, PROBE_WAIT_FLUSH } probe_state_t;
+
+static probe_state_t state = PROBE_IDLE;
+static probe_stamp_t active;
+static uint32_t taken;               // Último valor de posted adotado
+static uint32_t t_led;
+static uint32_t frames_at_led;
+
+void latency_probe_post(uint32_t seq, uint32_t obd_age_us, uint32_t t_parsed, uint32_t t_applied) {
+    // posted ímpar = escrevendo (mesma ideia do seqlock de telemetry.c)
+    uint32_t p = posted;
+    posted = p + 1;
+    __dmb();
+    posted_stamp.seq = seq;
+    posted_stamp.obd_age_us = obd_age_us;
+    posted_stamp.t_parsed = t_parsed;
+    posted_stamp.t_applied = t_applied;
+    __dmb();
+    posted = p + 2;
+}
+
+bool latency_frame_begin(void) {
+    uint32_t p = posted;
+    if (p == taken || (p & 1)) return state == PROBE_WAIT_LED;
+    __dmb();
+    probe_stamp_t copy = posted_stamp;
+    __dmb();
+    if (posted != p) return state == PROBE_WAIT_LED; // Sobrescrita durante a cópia: pega na próxima iteração
+
+    if (state != PROBE_IDLE) dropped++;
+    // Várias sondas entre duas iterações: só a última é medida
+    dropped += (p - taken) / 2 - 1;
+    taken = p;
+    active = copy;
+    state = PROBE_WAIT_LED;
+    return true;
+}
+
+void latency_led_written(uint32_t t_us, uint32_t frame_count) {
+    if (state != PROBE_WAIT_LED) return;
+    t_led = t_us;
+    frames_at_led = frame_count;
+    state = PROBE_WAIT_FLUSH;
+}
+
+static void send_echo(int32_t flush_us, uint32_t now_us) {
+    tp_probe_echo_t echo;
+    uint8_t frame[TP_MAX_FRAME + 2];
+
+    echo.seq = active.seq;
+    echo.obd_age_us = active.obd_age_us;
+    echo.applied_us = (int32_t)(active.t_applied - active.t_parsed);
+    echo.led_us = (int32_t)(t_led - active.t_parsed);
+    echo.flush_us = flush_us;
+    echo.echo_us = (int32_t)(now_us - active.t_parsed);
+    echo.dropped = dropped;
+
+    size_t n = tp_encode_probe_echo(&echo, frame, sizeof(frame));
+    if (n > 0) usb_link_send(frame, n);
+    state = PROBE_IDLE;
+}
+
+void latency_poll(uint32_t frame_count, uint32_t frame_t_us, uint32_t now_us) {
+    if (state != PROBE_WAIT_FLUSH) return;
+
+    if (frame_count != frames_at_led) {
+        send_echo((int32_t)(frame_t_us - active.t_parsed), now_us);
+    } else if (now_us - t_led > LATENCY_FLUSH_TIMEOUT_US) {
+        send_echo(-1, now_us);
+    }
+}
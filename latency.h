@@ -0,0 +1,37 @@
+/**
+ * @file latency.h
+ * @brief Sonda de latência ponta a ponta (host -> parse -> snapshot -> LEDs -> display)
+ *
+ * O host manda TP_MSG_PROBE com um número de sequência; o Pico marca o tempo
+ * em cada estágio e devolve tudo num TP_MSG_PROBE_ECHO:
+ *
+ *   parse    núcleo 1, quadro validado e interpretado (referência, t = 0)
+ *   applied  núcleo 1, canais da sonda publicados no snapshot
+ *   led      núcleo 0, npWrite() de uma iteração que leu esse snapshot
+ *   flush    núcleo 0, primeiro quadro do display concluído depois dos LEDs
+ *
+ * Só uma sonda fica em andamento; outra que chegue antes do eco substitui a
+ * pendente e a anterior conta como descartada. A passagem do núcleo 1 para o
+ * núcleo 0 é um slot único protegido por número de sequência: o núcleo 1
+ * publica o snapshot antes da sonda, e o núcleo 0 adota a sonda antes de ler
+ * o snapshot, então o npWrite seguinte sempre usa o valor da sonda.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LATENCY_FLUSH_TIMEOUT_US 500000 // Sem quadro do display até lá: eco sai com flush = -1
+
+// Núcleo 1, depois de telemetry_publish()
+void latency_probe_post(uint32_t seq, uint32_t obd_age_us, uint32_t t_parsed, uint32_t t_applied);
+
+// Núcleo 0, nesta ordem dentro do loop
+// Antes de telemetry_read(); true se há sonda esperando os LEDs: o npWrite não pode ser pulado
+bool latency_frame_begin(void);
+void latency_led_written(uint32_t t_us, uint32_t frame_count); // Depois de atualizarMatriz()
+void latency_poll(uint32_t frame_count, uint32_t frame_t_us, uint32_t now_us); // Depois de lv_timer_handler()
+
+#endif // LATENCY_H
@@ -0,0 +1,76 @@
+"""Mede a latência host -> LEDs -> display do Shift Light com sondas sintéticas.
+
+Manda quadros TP_MSG_PROBE com um RPM que varia a cada sonda (para os LEDs e
+o label mudarem de verdade) e imprime p50/p99/máx e o histograma de cada
+estágio a partir dos ecos do Pico (ver latency.h no firmware).
+
+Exemplos:
+    python latency_probe.py                      # 20 Hz por 10 s
+    python latency_probe.py --rate 50 --duration 30
+
+Sem a leitura OBD o estágio "parsed" mede só host -> Pico; com o get_rpm.py
+use LATENCY_PROBE = True, que conta também a partir da notificação BLE.
+Não rode junto com o get_rpm.py: os dois abririam a mesma porta.
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+import channels
+from telemetry_proto import (
+    TP_MSG_PROBE_ECHO, encode_probe, decode_probe_echo, find_pico_data_port,
+    LatencyStats, PicoLinkReader,
+)
+
+RPM_LOW = 1000
+RPM_HIGH = 7000
+RPM_STEP = 250
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", help="porta de telemetria (padrão: detecta pelo VID/PID)")
+    parser.add_argument("--rate", type=float, default=20.0, help="sondas por segundo")
+    parser.add_argument("--duration", type=float, default=10.0, help="segundos de medição")
+    args = parser.parse_args()
+
+    port = args.port or find_pico_data_port()
+    if port is None:
+        sys.exit("porta de telemetria do Pico não encontrada; use --port")
+
+    rpm = channels.BY_TAG[channels.TAG_RPM]
+    stats = LatencyStats()
+    reader = PicoLinkReader()
+    period = 1.0 / args.rate
+    seq = 0
+    value = RPM_LOW
+
+    with serial.Serial(port, 115200, timeout=0) as ser:
+        start = time.perf_counter()
+        next_probe = start
+        # Depois da última sonda espera mais um pouco pelos ecos que faltam
+        while time.perf_counter() - start < args.duration + 1.0:
+            now = time.perf_counter()
+            if now >= next_probe and now - start < args.duration:
+                seq += 1
+                value = value + RPM_STEP if value + RPM_STEP <= RPM_HIGH else RPM_LOW
+                ser.write(encode_probe(seq, 0, [(rpm.tag, channels.to_wire(rpm, value))]))
+                stats.on_send(seq)
+                next_probe += period
+            data = ser.read(max(1, ser.in_waiting))
+            t_recv = time.perf_counter()
+            for kind, payload in reader.feed(data):
+                if kind == "frame" and payload[0] == TP_MSG_PROBE_ECHO:
+                    stats.on_echo(decode_probe_echo(payload), t_recv)
+            if not data:
+                time.sleep(0.0005)
+
+    print(f"{seq} sondas enviadas\n")
+    print(stats.report())
+
+
+if __name__ == "__main__":
+    main()
@@ -6,6 +6,8 @@
 #include "lv_port_disp.h"
 #include "st7789_lcd_pio.h"
 #include "hardware/gpio.h"
+#include "profile.h"
+#include "trace.h"
 
 // --- Buffers de Desenho ---
 #define BUF_SIZE (SCREEN_WIDTH * SCREEN_HEIGHT / 10)
@@ -17,9 +19,17 @@ static uint8_t buf2[BUF_SIZE * sizeof(lv_color_t)];
 static PIO pio_disp;
 static uint sm_disp;
 
+static volatile uint32_t frame_count;
+static volatile uint32_t last_frame_us;
+static volatile uint32_t flush_us_total;
+
 
 static void disp_flush_cb(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map)
 {
+    PROF_BEGIN(flush);
+    TRACE_BEGIN(TRACE_FLUSH, area->y2 - area->y1 + 1);
+    uint32_t start_us = time_us_32();
+
     // 1. Usa as variáveis privadas para chamar a função de baixo nível
     lcd_set_window(pio_disp, sm_disp, area->x1, area->x2, area->y1, area->y2);
 
@@ -37,10 +47,35 @@ static void disp_flush_cb(lv_display_t * disp, const lv_area_t * area, uint8_t *
     st7789_lcd_wait_idle(pio_disp, sm_disp);
     lcd_set_dc_cs(1, 1); // Fim dos dados
 
-    // 3. Informa à LVGL que o envio terminou
+    // 3. Um quadro é vários flushes parciais; conta só o último
+    flush_us_total += time_us_32() - start_us;
+    if (lv_display_flush_is_last(disp)) {
+        last_frame_us = time_us_32();
+        frame_count++;
+    }
+
+    PROF_END(flush, PROF_FLUSH);
+    TRACE_END(TRACE_FLUSH, 0);
+
+    // 4. Informa à LVGL que o envio terminou
     lv_display_flush_ready(disp);
 }
 
+uint32_t lv_port_disp_frame_count(void)
+{
+    return frame_count;
+}
+
+uint32_t lv_port_disp_last_frame_us(void)
+{
+    return last_frame_us;
+}
+
+uint32_t lv_port_disp_flush_us(void)
+{
+    return flush_us_total;
+}
+
 void lv_port_disp_init(void)
 {
     // *** MUDANÇA CRÍTICA ***
@@ -9,6 +9,13 @@ extern "C" {
 
 void lv_port_disp_init(void);
 
+// Quadros completos enviados ao display e o instante (time_us_32) do último
+uint32_t lv_port_disp_frame_count(void);
+uint32_t lv_port_disp_last_frame_us(void);
+
+// Tempo total gasto em flushes, em us (use diferenças)
+uint32_t lv_port_disp_flush_us(void);
+
 #ifdef __cplusplus
 } /*extern "C"*/
 #endif
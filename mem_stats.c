@@ -0,0 +1,57 @@
+/**
+ * @file mem_stats.c
+ * @brief Pintura das pilhas e leitura do heap (ver mem_stats.h)
+ */
+
+#include <malloc.h>
+#include "mem_stats.h"
+#include "pico/stdlib.h"
+
+// Símbolos do linker script do SDK (memmap_default.ld)
+extern uint32_t __StackTop, __StackBottom, __StackOneTop, __StackOneBottom;
+extern uint32_t __scratch_y_end__, __scratch_x_end__;
+extern char __end__, __StackLimit;
+
+typedef struct {
+    uint32_t *start;   // Começo da região scratch livre (fim dos dados que o linker pôs lá)
+    uint32_t *bottom;  // Fundo do tamanho reservado
+    uint32_t *top;
+} stack_region_t;
+
+static stack_region_t region_of(unsigned core) {
+    if (core == 0) return (stack_region_t){ &__scratch_y_end__, &__StackBottom, &__StackTop };
+    return (stack_region_t){ &__scratch_x_end__, &__StackOneBottom, &__StackOneTop };
+}
+
+void __attribute__((noinline)) mem_paint_stack(void) {
+    stack_region_t r = region_of(get_core_num());
+    uintptr_t sp;
+    __asm volatile ("mov %0, sp" : "=r" (sp));
+
+    // Abaixo do sp nada está vivo; uma IRQ no meio só deixa a marca dela
+    for (uint32_t *p = r.start; (uintptr_t)p < sp - MEM_STACK_MARGIN; p++) *p = MEM_STACK_PAINT;
+}
+
+void mem_stack_usage(unsigned core, mem_stack_t *out) {
+    stack_region_t r = region_of(core);
+    const uint32_t *p = r.start;
+
+    while (p < r.top && *p == MEM_STACK_PAINT) p++;
+    out->used = (uint32_t)((const char *)r.top - (const char *)p);
+    out->size = (uint32_t)((const char *)r.top - (const char *)r.bottom);
+    out->region = (uint32_t)((const char *)r.top - (const char *)r.start);
+}
+
+bool mem_stack_overflowed(unsigned core) {
+    stack_region_t r = region_of(core);
+    return r.bottom > r.start && r.bottom[-1] != MEM_STACK_PAINT;
+}
+
+void mem_heap_usage(mem_heap_t *out) {
+    struct mallinfo mi = mallinfo();
+
+    out->in_use = (uint32_t)mi.uordblks;
+    out->free = (uint32_t)mi.fordblks;
+    out->arena = (uint32_t)mi.arena;
+    out->limit = (uint32_t)(&__StackLimit - &__end__);
+}
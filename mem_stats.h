@@ -0,0 +1,55 @@
+/**
+ * @file mem_stats.h
+ * @brief Pico de uso das pilhas dos dois núcleos e do heap do newlib
+ *
+ * Pilhas: cada núcleo pinta a própria região com MEM_STACK_PAINT logo ao
+ * começar (mem_paint_stack), do início da região scratch até um pouco abaixo
+ * do sp atual. A profundidade máxima é a distância do topo até a palavra
+ * pintada mais baixa que já foi sobrescrita. O núcleo 0 usa a SCRATCH_Y e o
+ * núcleo 1 a SCRATCH_X, cada uma de 4 KB, mas o tamanho reservado pelo SDK
+ * (PICO_STACK_SIZE e PICO_CORE1_STACK_SIZE) é só a metade de cima; passar
+ * dele ainda não corrompe nada, passar da região invade a pilha do outro
+ * núcleo (ou dados da RAM). mem_stack_overflowed() olha só a palavra logo
+ * abaixo do tamanho reservado, então cabe numa tarefa periódica.
+ *
+ * Heap: mallinfo() do newlib dá o que está em uso e o que está livre dentro
+ * da arena; a arena só cresce (sbrk), então é o pico do heap. O limite é o
+ * que o _sbrk do SDK aceita dar, até __StackLimit.
+ *
+ * Sai pelo RPC TP_RPC_GET_MEMORY (pico_rpc.py memory), junto com as
+ * estatísticas do TLSF do LVGL (lv_mem_monitor).
+ */
+
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MEM_STACK_PAINT  0xDEADBEEFu
+#define MEM_STACK_MARGIN 64 // Bytes abaixo do sp que não são pintados (o próprio mem_paint_stack)
+
+typedef struct {
+    uint32_t used;    // Profundidade máxima desde a pintura, em bytes
+    uint32_t size;    // Tamanho reservado pelo SDK
+    uint32_t region;  // Do topo até o começo da região scratch
+} mem_stack_t;
+
+typedef struct {
+    uint32_t in_use;  // Blocos alocados (mallinfo uordblks)
+    uint32_t free;    // Livre dentro da arena (fordblks)
+    uint32_t arena;   // Tirado do sistema até agora: o pico do heap
+    uint32_t limit;   // Máximo que o sbrk pode dar
+} mem_heap_t;
+
+// Cada núcleo chama uma vez, no começo, para pintar a própria pilha
+void mem_paint_stack(void);
+
+void mem_stack_usage(unsigned core, mem_stack_t *out);
+
+// true se o núcleo já passou do tamanho reservado da pilha
+bool mem_stack_overflowed(unsigned core);
+
+void mem_heap_usage(mem_heap_t *out);
+
+#endif // MEM_STATS_H
@@ -0,0 +1,295 @@
+"""Cliente RPC do Shift Light pela porta de telemetria (ver TP_MSG_RPC_* em telemetry_proto.h).
+
+Exemplos:
+    python pico_rpc.py ping
+    python pico_rpc.py get rpm_target
+    python pico_rpc.py set brightness 300        # milésimos
+    python pico_rpc.py counters
+    python pico_rpc.py channels                   # idade e taxa medida de cada canal
+    python pico_rpc.py tasks                      # tempo e overruns das tarefas do núcleo 0
+    python pico_rpc.py profile                    # tempo por etapa dos dois núcleos
+    python pico_rpc.py profile np_write --reset   # histograma de uma etapa, depois zera
+    python pico_rpc.py memory                     # pilhas, heap e memória do LVGL
+    python pico_rpc.py trace 5 -o captura.json    # 5 s de eventos dos dois núcleos para o Perfetto
+    python pico_rpc.py history
+    python pico_rpc.py bench crc16 10000
+
+Não rode junto com o get_rpm.py: os dois abririam a mesma porta.
+"""
+
+import argparse
+import json
+import sys
+import time
+
+import serial
+
+import channels
+import trace_export
+from telemetry_proto import (
+    TP_MSG_RPC_RESPONSE, RPC_PING, RPC_GET_PARAM, RPC_SET_PARAM, RPC_GET_COUNTERS,
+    RPC_READ_HISTORY, RPC_RUN_BENCHMARK, RPC_GET_CHANNELS, RPC_GET_TASKS, RPC_GET_PROFILE, RPC_TRACE_CONTROL,
+    RPC_READ_TRACE, RPC_GET_MEMORY, RPC_OK, RPC_ERR_BUSY,
+    PARAMS, BENCHMARKS, COUNTER_NAMES, TASK_NAMES, PROFILE_STAGES, PROFILE_BUCKETS, encode_rpc_request, decode_rpc_response, find_pico_data_port,
+    PicoLinkReader,
+)
+
+RPC_ERRORS = {1: "método desconhecido", 2: "argumento inválido", 3: "ocupado", 4: "resposta grande demais"}
+
+
+class RpcError(Exception):
+    pass
+
+
+class RpcClient:
+    """Requisição/resposta síncrona; respostas são casadas pelo seq."""
+
+    def __init__(self, ser, timeout=0.5, retries=3):
+        self.ser = ser
+        self.timeout = timeout
+        self.retries = retries
+        self.reader = PicoLinkReader()
+        self.seq = 0
+        self.other_events = []  # Status/linhas que chegaram no meio; o chamador decide o que fazer
+
+    def call(self, method, *args):
+        for _ in range(self.retries):
+            self.seq = (self.seq + 1) & 0xFF
+            self.ser.write(encode_rpc_request(self.seq, method, args))
+            status, values = self._wait_response(self.seq, method)
+            if status is None:
+                continue  # Timeout: repete com outro seq
+            if status == RPC_ERR_BUSY:
+                time.sleep(0.005)
+                continue
+            if status != RPC_OK:
+                raise RpcError(RPC_ERRORS.get(status, f"status {status}"))
+            return values
+        raise RpcError("sem resposta (timeout ou ocupado)")
+
+    def _wait_response(self, seq, method):
+        deadline = time.monotonic() + self.timeout
+        while time.monotonic() < deadline:
+            data = self.ser.read(max(1, self.ser.in_waiting))
+            for kind, payload in self.reader.feed(data):
+                if kind == "frame" and payload[0] == TP_MSG_RPC_RESPONSE:
+                    r_seq, r_method, status, values = decode_rpc_response(payload)
+                    if r_seq == seq and r_method == method:
+                        return status, values
+                else:
+                    self.other_events.append((kind, payload))
+        return None, None
+
+    # --- Métodos ---
+
+    def ping(self):
+        start = time.perf_counter()
+        self.call(RPC_PING)
+        return time.perf_counter() - start
+
+    def get_param(self, name):
+        return self.call(RPC_GET_PARAM, PARAMS[name])[1]
+
+    def set_param(self, name, value):
+        return self.call(RPC_SET_PARAM, PARAMS[name], value)[1]
+
+    def counters(self):
+        values = []
+        total = None
+        while total is None or len(values) < total:
+            total, first, *page = self.call(RPC_GET_COUNTERS, len(values))
+            if not page:
+                break
+            values += page
+        names = COUNTER_NAMES + tuple(f"counter_{i}" for i in range(len(COUNTER_NAMES), len(values)))
+        return dict(zip(names, values))
+
+    def channels(self):
+        """Frescor por canal: {nome: (idade em ms ou None, taxa medida em Hz)}."""
+        result = {}
+        first = 0
+        while True:
+            total, first, *flat = self.call(RPC_GET_CHANNELS, first)
+            for i in range(0, len(flat), 3):
+                tag, age_ms, centihz = flat[i:i + 3]
+                channel = channels.BY_TAG.get(tag)
+                result[channel.name if channel else f"tag {tag}"] = (None if age_ms < 0 else age_ms, centihz / 100)
+            first += len(flat) // 3
+            if not flat or first >= total:
+                return result
+
+    def tasks(self):
+        """Tarefas do escalonador: {nome: dict(period_us, budget_us, runs, overruns, missed, max_us, last_us)}."""
+        fields = ("period_us", "budget_us", "runs", "overruns", "missed", "max_us", "last_us")
+        result = {}
+        first = 0
+        while True:
+            total, first, *flat = self.call(RPC_GET_TASKS, first)
+            for i in range(0, len(flat), len(fields)):
+                index = first + i // len(fields)
+                name = TASK_NAMES[index] if index < len(TASK_NAMES) else f"task_{index}"
+                result[name] = dict(zip(fields, flat[i:i + len(fields)]))
+            first += len(flat) // len(fields)
+            if not flat or first >= total:
+                return result
+
+    def profile(self, name, reset=False):
+        """Etapa do perfil em us: dict(count, min_us, max_us, mean_us, hist=[(limite superior em us, n)])."""
+        _, khz, count, lo, hi, mean, *hist = self.call(RPC_GET_PROFILE, PROFILE_STAGES.index(name), int(reset))
+        us = 1000.0 / khz
+        bounds = [(1 << (i + 5)) * us for i in range(PROFILE_BUCKETS - 1)] + [float("inf")]
+        return {"count": count, "min_us": lo * us, "max_us": hi * us, "mean_us": mean * us,
+                "hist": list(zip(bounds, hist))}
+
+    def memory(self):
+        """Uso de memória em bytes: {"stack0"/"stack1": (usada, reservada, região), "heap": dict, "lvgl": dict}."""
+        v = self.call(RPC_GET_MEMORY)
+        return {
+            "stack0": tuple(v[0:3]),
+            "stack1": tuple(v[3:6]),
+            "heap": dict(zip(("in_use", "free", "arena", "limit"), v[6:10])),
+            "lvgl": dict(zip(("total", "free", "biggest_free", "max_used", "frag_pct", "used_blocks"), v[10:16])),
+        }
+
+    def trace_control(self, start):
+        """Liga (zerando) ou para o trace: (gravando, eventos do núcleo 0, eventos do núcleo 1, tamanho do ring)."""
+        return tuple(self.call(RPC_TRACE_CONTROL, int(start)))
+
+    def read_trace(self, core):
+        """Ring de trace de um núcleo: (total gravado, [(t_us, fase, evento, arg)]), do mais antigo disponível."""
+        events = []
+        index = 0
+        while True:
+            total, first, count, *flat = self.call(RPC_READ_TRACE, core, index)
+            t_us = 0
+            for i in range(count):
+                dt, packed = flat[2 * i:2 * i + 2]
+                t_us = (t_us + dt) & 0xFFFFFFFF
+                events.append((t_us, packed >> 24, (packed >> 16) & 0xFF, packed & 0xFFFF))
+            index = first + count
+            if count == 0 or index >= total:
+                return total, events
+
+    def history(self, start=0):
+        """Amostras do histórico do Pico a partir do índice absoluto start: (índice, tag, valor, t_us)."""
+        samples = []
+        index = start
+        while True:
+            total, first, count, *flat = self.call(RPC_READ_HISTORY, index)
+            t_us = 0
+            for i in range(count):
+                tag, value, dt = flat[3 * i:3 * i + 3]
+                t_us = (t_us + dt) & 0xFFFFFFFF
+                samples.append((first + i, tag, value, t_us))
+            index = first + count
+            if count == 0 or index >= total:
+                return samples
+
+    def benchmark(self, name, iterations):
+        _, iterations, elapsed_us = self.call(RPC_RUN_BENCHMARK, BENCHMARKS[name], iterations)
+        return elapsed_us, iterations
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", help="porta de telemetria (padrão: detecta pelo VID/PID)")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("ping")
+    p = sub.add_parser("get")
+    p.add_argument("param", choices=PARAMS)
+    p = sub.add_parser("set")
+    p.add_argument("param", choices=PARAMS)
+    p.add_argument("value", type=int)
+    sub.add_parser("counters")
+    sub.add_parser("channels")
+    sub.add_parser("tasks")
+    p = sub.add_parser("profile")
+    p.add_argument("stage", nargs="?", choices=PROFILE_STAGES, help="só esta etapa, com histograma")
+    p.add_argument("--reset", action="store_true", help="zera a etapa depois de ler")
+    sub.add_parser("memory")
+    p = sub.add_parser("trace")
+    p.add_argument("seconds", type=float, nargs="?", default=5.0)
+    p.add_argument("-o", "--output", default="trace.json", help="JSON do Perfetto; o dump bruto vai junto, em .bin")
+    p = sub.add_parser("history")
+    p.add_argument("--start", type=int, default=0)
+    p = sub.add_parser("bench")
+    p.add_argument("name", choices=BENCHMARKS)
+    p.add_argument("iterations", type=int, nargs="?", default=10000)
+    args = parser.parse_args()
+
+    port = args.port or find_pico_data_port()
+    if port is None:
+        sys.exit("porta de telemetria do Pico não encontrada; use --port")
+
+    with serial.Serial(port, 115200, timeout=0.05) as ser:
+        rpc = RpcClient(ser)
+        if args.cmd == "ping":
+            print(f"pong em {rpc.ping() * 1000:.2f} ms")
+        elif args.cmd == "get":
+            print(f"{args.param} = {rpc.get_param(args.param)}")
+        elif args.cmd == "set":
+            print(f"{args.param} = {rpc.set_param(args.param, args.value)}")
+        elif args.cmd == "counters":
+            for name, value in rpc.counters().items():
+                print(f"{name:20s} {value}")
+        elif args.cmd == "channels":
+            for name, (age_ms, hz) in rpc.channels().items():
+                age = "nunca" if age_ms is None else f"{age_ms} ms"
+                print(f"{name:12s} idade {age:>10s}  {hz:6.2f} Hz")
+        elif args.cmd == "tasks":
+            print(f"{'tarefa':14s} {'período':>9s} {'orçam.':>7s} {'execuções':>10s} {'overruns':>9s} "
+                  f"{'perdidos':>9s} {'máx us':>8s} {'última':>7s}")
+            for name, t in rpc.tasks().items():
+                print(f"{name:14s} {t['period_us']:9d} {t['budget_us']:7d} {t['runs']:10d} {t['overruns']:9d} "
+                      f"{t['missed']:9d} {t['max_us']:8d} {t['last_us']:7d}")
+        elif args.cmd == "profile":
+            stages = [args.stage] if args.stage else PROFILE_STAGES
+            print(f"{'etapa':12s} {'n':>9s} {'mín us':>9s} {'média us':>9s} {'máx us':>9s}")
+            for name in stages:
+                p = rpc.profile(name, args.reset)
+                print(f"{name:12s} {p['count']:9d} {p['min_us']:9.1f} {p['mean_us']:9.1f} {p['max_us']:9.1f}")
+            if args.stage and p["count"]:
+                peak = max(n for _, n in p["hist"])
+                for bound, n in p["hist"]:
+                    if n:
+                        label = f"< {bound:.1f} us" if bound != float("inf") else "resto"
+                        print(f"  {label:>14s} {n:9d} {'#' * max(1, n * 50 // peak)}")
+        elif args.cmd == "memory":
+            m = rpc.memory()
+            for core in (0, 1):
+                used, size, region = m[f"stack{core}"]
+                warn = "  ESTOUROU o reservado" if used > size else ""
+                print(f"pilha núcleo {core}: {used} de {size} bytes reservados ({region} na região){warn}")
+            h = m["heap"]
+            print(f"heap newlib:    {h['in_use']} em uso, {h['free']} livre na arena, pico (arena) {h['arena']} "
+                  f"de {h['limit']}")
+            lv = m["lvgl"]
+            print(f"LVGL (TLSF):    {lv['total'] - lv['free']} em uso de {lv['total']}, pico {lv['max_used']}, "
+                  f"maior bloco livre {lv['biggest_free']}, fragmentação {lv['frag_pct']}%, {lv['used_blocks']} blocos")
+        elif args.cmd == "trace":
+            _, _, _, ring_size = rpc.trace_control(True)
+            time.sleep(args.seconds)
+            rpc.trace_control(False)
+            cores = {core: rpc.read_trace(core) for core in (0, 1)}
+            dump = args.output.rsplit(".", 1)[0] + ".bin"
+            trace_export.write_dump(dump, cores)
+            with open(args.output, "w") as f:
+                json.dump(trace_export.to_chrome(cores), f)
+            for core, (total, events) in cores.items():
+                print(f"núcleo {core}: {total} eventos, {total - len(events)} sobrescritos (ring de {ring_size})")
+            print(f"{args.output}: abra em https://ui.perfetto.dev ({dump}: dump bruto)")
+        elif args.cmd == "history":
+            for index, tag, value, t_us in rpc.history(args.start):
+                channel = channels.BY_TAG.get(tag)
+                name = channel.name if channel else f"tag {tag}"
+                print(f"{index:8d} {t_us:12d} us  {name:10s} {value}")
+        elif args.cmd == "bench":
+            elapsed_us, iterations = rpc.benchmark(args.name, args.iterations)
+            print(f"{args.name}: {iterations} iterações em {elapsed_us} us "
+                  f"({elapsed_us * 1000 / iterations:.1f} ns/iteração)")
+            if iterations < args.iterations:
+                print(f"  (parou no limite de tempo do Pico; pedidas {args.iterations})")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,47 @@
+/**
+ * @file profile.c
+ * @brief Estatísticas por etapa em ciclos (ver profile.h)
+ */
+
+#include <string.h>
+#include "profile.h"
+#include "hardware/sync.h"
+
+#define SYSTICK_MASK 0x00FFFFFFu
+
+static prof_stat_t stats[PROF_STAGE_COUNT];
+
+void profile_init_core(void) {
+    systick_hw->rvr = SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS; // clk_sys, sem IRQ
+}
+
+void profile_add(prof_stat_t *stat, uint32_t cycles) {
+    if (stat->reset) {
+        stat->count = 0;
+        stat->total = 0;
+        stat->max = 0;
+        memset(stat->hist, 0, sizeof(stat->hist));
+        stat->reset = false;
+    }
+    if (stat->count == 0 || cycles < stat->min) stat->min = cycles;
+    if (cycles > stat->max) stat->max = cycles;
+    stat->count++;
+    stat->total += cycles;
+
+    // log2 com clz da ROM (pico_bit_ops); < 32 ciclos vai para a faixa 0
+    int bucket = cycles < 32 ? 0 : 31 - __builtin_clz(cycles) - 4;
+    if (bucket >= PROF_BUCKETS) bucket = PROF_BUCKETS - 1;
+    stat->hist[bucket]++;
+}
+
+void profile_end(prof_stage_t stage, uint32_t start) {
+    profile_add(&stats[stage], (start - systick_hw->cvr) & SYSTICK_MASK);
+}
+
+void profile_get(prof_stage_t stage, prof_stat_t *out, bool reset) {
+    memcpy(out, &stats[stage], sizeof(*out));
+    __dmb();
+    if (reset) stats[stage].reset = true;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file profile.h
+ * @brief Perfil por etapa do loop dos dois núcleos, em ciclos do SysTick
+ *
+ * Cada etapa (lv_timer_handler, flush do display, npWrite, rótulos, dreno do
+ * USB no núcleo 1...) é cercada por PROF_BEGIN/PROF_END. O SysTick de cada
+ * núcleo conta ciclos de clk_sys para baixo em 24 bits (~134 ms a 125 MHz),
+ * então uma medida custa duas leituras de registrador e uma soma; etapas
+ * mais longas que a volta do contador saem erradas, nenhuma chega perto.
+ *
+ * Por etapa: contagem, mínimo, máximo, média e histograma log2 de
+ * PROF_BUCKETS faixas (faixa 0: < 32 ciclos; faixa i: 2^(i+4)..2^(i+5)-1;
+ * a última acumula o resto). Cada etapa é sempre medida pelo mesmo núcleo,
+ * então não há lock; o núcleo 0 lê as do núcleo 1 sem parar nada (uma
+ * leitura pode misturar duas medidas, o que não importa para estatística).
+ * Zerar é um pedido que o núcleo dono atende na próxima medida.
+ *
+ * Sai pelo RPC TP_RPC_GET_PROFILE (pico_rpc.py profile). Com
+ * PROFILE_ENABLED 0 as marcações somem do binário.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/structs/systick.h"
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED 1 // Barato o bastante para ficar ligado (ver TP_BENCH_PROFILE)
+#endif
+
+#define PROF_BUCKETS 20
+
+// A ordem é a de PROFILE_STAGES em telemetry_proto.py
+typedef enum {
+    PROF_LVGL = 0,     // Núcleo 0: lv_timer_handler (inclui os flushes)
+    PROF_FLUSH,        // Núcleo 0: disp_flush_cb, uma área parcial
+    PROF_NP_WRITE,     // Núcleo 0: npWrite com o sleep_us(100) do reset dos LEDs
+    PROF_LABEL_TEXT,   // Núcleo 0: label_printf (formatação + lv_label_set_text)
+    PROF_RPC,          // Núcleo 0: handle_rpc
+    PROF_USB_DRAIN,    // Núcleo 1: core1_drain_usb (parse e aplicação das mensagens)
+    PROF_PUBLISH,      // Núcleo 1: telemetry_publish
+    PROF_ELM_POLL,     // Núcleo 1: core1_poll_elm
+    PROF_CAN_DRAIN,    // Núcleo 1: core1_drain_can
+    PROF_STAGE_COUNT
+} prof_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROF_BUCKETS];
+    volatile bool reset;  // Pedido de zerar, atendido pelo núcleo dono
+} prof_stat_t;
+
+// Cada núcleo chama uma vez antes de medir: liga o próprio SysTick
+void profile_init_core(void);
+
+// Leitura crua do SysTick do núcleo atual (decrescente, 24 bits)
+static inline uint32_t profile_cycles(void) {
+    return systick_hw->cvr;
+}
+
+void profile_add(prof_stat_t *stat, uint32_t cycles);
+void profile_end(prof_stage_t stage, uint32_t start);
+
+// Cópia da etapa (núcleo 0); reset = pede para zerar depois da cópia
+void profile_get(prof_stage_t stage, prof_stat_t *out, bool reset);
+
+#if PROFILE_ENABLED
+#define PROF_BEGIN(name)       uint32_t prof_start_##name = profile_cycles()
+#define PROF_END(name, stage)  profile_end((stage), prof_start_##name)
+#else
+#define PROF_BEGIN(name)       ((void)0)
+#define PROF_END(name, stage)  ((void)0)
+#endif
+
+#endif // PROFILE_H
@@ -0,0 +1,182 @@
+/**
+ * @file rpc.c
+ * @brief Fila de requisições RPC e micro-benchmarks (ver rpc.h)
+ */
+
+#include <string.h>
+#include "rpc.h"
+#include "usb_link.h"
+#include "telemetry.h"
+#include "can_decoder.h"
+#include "profile.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#define QUEUE_MASK (RPC_QUEUE_DEPTH - 1)
+
+static tp_rpc_request_t queue[RPC_QUEUE_DEPTH];
+static volatile uint32_t queue_head; // Escrito só pelo núcleo 1
+static volatile uint32_t queue_tail; // Escrito só pelo núcleo 0
+static volatile uint32_t busy_count;
+static volatile uint32_t too_big_count;
+
+void rpc_post(const tp_rpc_request_t *req) {
+    uint32_t head = queue_head;
+
+    if (head - queue_tail >= RPC_QUEUE_DEPTH) {
+        busy_count++;
+        rpc_reply(req, TP_RPC_ERR_BUSY, NULL, 0);
+        return;
+    }
+
+    queue[head & QUEUE_MASK] = *req;
+    __dmb(); // Requisição visível antes do novo head
+    queue_head = head + 1;
+    __sev(); // Acorda o núcleo 0 se estiver em __wfe()
+}
+
+bool rpc_pending(void) {
+    return queue_tail != queue_head;
+}
+
+bool rpc_poll(tp_rpc_request_t *out) {
+    uint32_t tail = queue_tail;
+
+    if (tail == queue_head) return false;
+    __dmb();
+
+    *out = queue[tail & QUEUE_MASK];
+
+    __dmb(); // Cópia concluída antes de liberar o slot
+    queue_tail = tail + 1;
+    return true;
+}
+
+void rpc_reply(const tp_rpc_request_t *req, uint8_t status, const int32_t *values, uint8_t count) {
+    tp_rpc_response_t resp;
+    uint8_t frame[TP_MAX_FRAME + 2];
+
+    if (count > TP_RPC_MAX_VALUES) count = TP_RPC_MAX_VALUES;
+    resp.seq = req->seq;
+    resp.method = req->method;
+    resp.status = status;
+    resp.count = count;
+    if (count) memcpy(resp.value, values, count * sizeof(values[0]));
+
+    size_t n = tp_encode_rpc_response(&resp, frame, sizeof(frame));
+    if (n == 0) {
+        // Valores não couberam: responde o erro em vez de deixar o host esperar o timeout
+        too_big_count++;
+        resp.status = TP_RPC_ERR_SIZE;
+        resp.count = 0;
+        n = tp_encode_rpc_response(&resp, frame, sizeof(frame));
+    }
+    if (n > 0) usb_link_send(frame, n);
+}
+
+uint32_t rpc_busy_count(void) {
+    return busy_count;
+}
+
+uint32_t rpc_too_big_count(void) {
+    return too_big_count;
+}
+
+// --- Micro-benchmarks ---
+
+// O acumulador global impede o compilador de descartar o trabalho medido
+static volatile uint32_t bench_sink;
+
+// Quadro de 8 bytes como o PIO entrega: barramento livre antes do SOF e
+// palavras de 32 bits completadas com recessivos. Retorna quantas palavras.
+static size_t bench_can_words(uint32_t *words, size_t max_words) {
+    static const can_frame_t frame = { .id = 0x107, .dlc = 8, .data = { 0x12, 0x00, 0x40, 0x36, 0x00, 0x00, 0xA5, 0x5A } };
+    uint8_t bits[CAN_IDLE_BITS + CAN_MAX_FRAME_BITS];
+    size_t n;
+
+    memset(bits, 1, CAN_IDLE_BITS);
+    n = CAN_IDLE_BITS + can_encode_frame(&frame, &bits[CAN_IDLE_BITS], CAN_MAX_FRAME_BITS);
+    memset(words, 0xFF, max_words * sizeof(uint32_t));
+    for (size_t i = 0; i < n && i / 32 < max_words; i++) {
+        if (!bits[i]) words[i / 32] &= ~(0x80000000u >> (i % 32));
+    }
+    return (n + 31) / 32;
+}
+
+#define BENCH_BATCH 32 // Iterações entre duas leituras do relógio
+
+bool rpc_run_benchmark(int id, uint32_t iterations, uint32_t max_us, uint32_t *done, uint32_t *elapsed_us) {
+    static uint8_t data[64];
+    static uint8_t encoded[TP_MAX_FRAME];
+    static uint8_t decoded[64];
+    static can_decoder_t dec;
+    static prof_stat_t stat; // Fora das etapas reais, para não sujar o perfil
+    uint32_t words[(CAN_IDLE_BITS + CAN_MAX_FRAME_BITS + 31) / 32];
+    size_t word_count = 0;
+    telemetry_snapshot_t snap;
+    uint32_t sink = 0;
+
+    if (id < 0 || id >= TP_BENCH_COUNT) return false;
+
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 37 + 1);
+    data[10] = 0; // Pelo menos um zero para o COBS trabalhar
+    memset(&snap, 0, sizeof(snap));
+    memset(&stat, 0, sizeof(stat));
+    if (id == TP_BENCH_CAN_DECODE) {
+        word_count = bench_can_words(words, sizeof(words) / sizeof(words[0]));
+        can_decoder_init(&dec, NULL, NULL);
+    }
+
+    // Em lotes, com o relógio conferido entre eles: o tempo fora do loop do
+    // núcleo 0 fica limitado por max_us qualquer que seja o benchmark
+    uint64_t start = time_us_64();
+    uint32_t i = 0;
+    while (i < iterations) {
+        uint32_t end = iterations - i > BENCH_BATCH ? i + BENCH_BATCH : iterations;
+        switch (id) {
+            case TP_BENCH_CRC16:
+                for (; i < end; i++) {
+                    sink += tp_crc16(data, sizeof(data));
+                }
+                break;
+            case TP_BENCH_COBS:
+                for (; i < end; i++) {
+                    size_t n = tp_cobs_encode(data, sizeof(data), encoded, sizeof(encoded));
+                    sink += tp_cobs_decode(encoded, n, decoded, sizeof(decoded));
+                }
+                break;
+            case TP_BENCH_TEXT_LINE:
+                for (; i < end; i++) {
+                    int tag;
+                    int32_t value;
+                    if (tp_parse_tag_value("1,3500", &tag, &value)) sink += (uint32_t)value;
+                }
+                break;
+            case TP_BENCH_CHANNEL_APPLY:
+                for (; i < end; i++) {
+                    for (int k = 0; k < CH_SWEEP_COUNT; k++) {
+                        telemetry_apply(&snap, channel_info[channel_sweep_slots[k]].tag, (int32_t)i, i);
+                    }
+                }
+                break;
+            case TP_BENCH_CAN_DECODE:
+                for (; i < end; i++) {
+                    for (size_t k = 0; k < word_count; k++) can_decoder_feed_word(&dec, words[k]);
+                }
+                break;
+            case TP_BENCH_PROFILE:
+                for (; i < end; i++) {
+                    uint32_t t = profile_cycles();
+                    profile_add(&stat, (t - profile_cycles()) & 0x00FFFFFFu);
+                }
+                break;
+        }
+        if (time_us_64() - start >= max_us) break;
+    }
+    *elapsed_us = (uint32_t)(time_us_64() - start);
+    *done = i;
+
+    sink += snap.updates + dec.stats.frames + stat.count;
+    bench_sink = sink;
+    return true;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file rpc.h
+ * @brief Requisições RPC do host (ver TP_MSG_RPC_REQUEST em telemetry_proto.h)
+ *
+ * O núcleo 1 recebe e valida o quadro e só o repassa por uma fila SPSC de
+ * tamanho fixo; quem executa é o núcleo 0, dono dos parâmetros, do histórico
+ * de amostras e da UI, na tarefa de link do loop principal (rpc_post() dá
+ * __sev() e o loop antecipa a tarefa quando rpc_pending()). Com a fila cheia
+ * o núcleo 1 responde TP_RPC_ERR_BUSY na hora. As respostas saem pela
+ * fila de usb_link_send(), então nenhum lado espera pelo host.
+ */
+
+#ifndef RPC_H
+#define RPC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "telemetry_proto.h"
+
+#define RPC_QUEUE_DEPTH 8 // Potência de 2
+
+// Núcleo 1: enfileira a requisição ou responde "ocupado"
+void rpc_post(const tp_rpc_request_t *req);
+
+// Núcleo 0: próxima requisição pendente
+bool rpc_poll(tp_rpc_request_t *out);
+bool rpc_pending(void);
+
+// Envia a resposta de req com os valores dados
+void rpc_reply(const tp_rpc_request_t *req, uint8_t status, const int32_t *values, uint8_t count);
+
+uint32_t rpc_busy_count(void);
+uint32_t rpc_too_big_count(void); // Respostas trocadas por TP_RPC_ERR_SIZE
+
+// Roda o micro-benchmark id (tp_bench_t) por até iterations vezes, parando
+// antes se passar de max_us; done recebe quantas rodaram. false se o id não existe
+bool rpc_run_benchmark(int id, uint32_t iterations, uint32_t max_us, uint32_t *done, uint32_t *elapsed_us);
+
+#endif // RPC_H
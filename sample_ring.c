@@ -0,0 +1,95 @@
+/**
+ * @file sample_ring.c
+ * @brief Implementação do ring SPSC de amostras (ver sample_ring.h)
+ */
+
+#include "sample_ring.h"
+#include "hardware/sync.h"
+
+#define RING_MASK    (SAMPLE_RING_SIZE - 1)
+#define HISTORY_MASK (SAMPLE_HISTORY_SIZE - 1)
+
+static telemetry_sample_t ring[SAMPLE_RING_SIZE];
+static volatile uint32_t ring_head;   // Escrito só pelo produtor
+static volatile uint32_t ring_tail;   // Escrito só pelo consumidor
+static volatile uint32_t dropped;
+
+static telemetry_sample_t history[SAMPLE_HISTORY_SIZE];
+static uint32_t history_total;        // Amostras já gravadas no histórico
+
+bool sample_ring_push(uint8_t tag, int32_t value, uint32_t t_us) {
+    uint32_t head = ring_head;
+
+    if (head - ring_tail >= SAMPLE_RING_SIZE) {
+        dropped++;
+        return false;
+    }
+
+    telemetry_sample_t *s = &ring[head & RING_MASK];
+    s->t_us = t_us;
+    s->value = value;
+    s->tag = tag;
+
+    __dmb(); // Amostra visível antes do novo head
+    ring_head = head + 1;
+    return true;
+}
+
+bool sample_ring_pop(telemetry_sample_t *out) {
+    uint32_t tail = ring_tail;
+
+    if (tail == ring_head) return false;
+    __dmb();
+
+    *out = ring[tail & RING_MASK];
+
+    __dmb(); // Cópia concluída antes de liberar o slot
+    ring_tail = tail + 1;
+    return true;
+}
+
+size_t sample_ring_drain_to_history(void) {
+    size_t n = 0;
+    while (sample_ring_pop(&history[history_total & HISTORY_MASK])) {
+        history_total++;
+        n++;
+    }
+    return n;
+}
+
+uint32_t sample_ring_level(void) {
+    return ring_head - ring_tail;
+}
+
+uint32_t sample_ring_dropped(void) {
+    return dropped;
+}
+
+uint32_t sample_history_count(void) {
+    return history_total;
+}
+
+// Copia as amostras do histórico da mais antiga para a mais recente
+size_t sample_history_copy(telemetry_sample_t *out, size_t max) {
+    uint32_t available = history_total < SAMPLE_HISTORY_SIZE ? history_total : SAMPLE_HISTORY_SIZE;
+    if (max > available) max = available;
+
+    uint32_t first = history_total - max;
+    for (size_t i = 0; i < max; i++) {
+        out[i] = history[(first + i) & HISTORY_MASK];
+    }
+    return max;
+}
+
+size_t sample_history_copy_from(uint32_t *first, telemetry_sample_t *out, size_t max) {
+    uint32_t oldest = history_total > SAMPLE_HISTORY_SIZE ? history_total - SAMPLE_HISTORY_SIZE : 0;
+    if ((int32_t)(*first - oldest) < 0) *first = oldest;
+    if ((int32_t)(history_total - *first) <= 0) return 0;
+
+    uint32_t available = history_total - *first;
+    if (max > available) max = available;
+    for (size_t i = 0; i < max; i++) {
+        out[i] = history[(*first + i) & HISTORY_MASK];
+    }
+    return max;
+}
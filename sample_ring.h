@@ -0,0 +1,48 @@
+/**
+ * @file sample_ring.h
+ * @brief Fila lock-free SPSC de amostras com timestamp (núcleo 1 -> núcleo 0)
+ *
+ * Complementa o snapshot de telemetry.h: o snapshot entrega só o valor mais
+ * recente, enquanto este ring preserva cada amostra recebida, para consumidores
+ * que precisam do histórico (derivadas, datalog, gráficos).
+ *
+ * O produtor (núcleo 1) nunca bloqueia: com o ring cheio a amostra nova é
+ * descartada e contada em dropped. O consumidor (núcleo 0) esvazia o ring a
+ * cada iteração e mantém as últimas SAMPLE_HISTORY_SIZE amostras em memória.
+ */
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_RING_SIZE    256 // Potência de 2
+#define SAMPLE_HISTORY_SIZE 128 // Potência de 2
+
+typedef struct {
+    uint32_t t_us;   // time_us_32() no núcleo 1 quando o canal foi aplicado
+    int32_t value;   // Valor bruto do fio (mesma escala do protocolo)
+    uint8_t tag;
+} telemetry_sample_t;
+
+// Produtor (somente núcleo 1)
+bool sample_ring_push(uint8_t tag, int32_t value, uint32_t t_us);
+
+// Consumidor (somente núcleo 0)
+bool sample_ring_pop(telemetry_sample_t *out);
+size_t sample_ring_drain_to_history(void);
+
+uint32_t sample_ring_level(void);
+uint32_t sample_ring_dropped(void);
+
+// Histórico das últimas amostras (acessado só pelo núcleo 0)
+uint32_t sample_history_count(void);
+size_t sample_history_copy(telemetry_sample_t *out, size_t max);
+
+// Copia a partir do índice absoluto *first (contado desde o boot); se ele já
+// saiu do histórico, avança *first até a amostra mais antiga disponível
+size_t sample_history_copy_from(uint32_t *first, telemetry_sample_t *out, size_t max);
+
+#endif // SAMPLE_RING_H
@@ -0,0 +1,95 @@
+/**
+ * @file scheduler.c
+ * @brief Implementação do escalonador por prazos (ver scheduler.h)
+ */
+
+#include "scheduler.h"
+#include "trace.h"
+
+void sched_init(sched_t *s, sched_task_t *tasks, size_t count, sched_clock_fn clock) {
+    uint32_t now = clock();
+
+    s->tasks = tasks;
+    s->count = count;
+    s->clock = clock;
+    for (size_t i = 0; i < count; i++) {
+        tasks[i].next_due_us = now;
+        tasks[i].deferred = false;
+        tasks[i].runs = tasks[i].overruns = tasks[i].missed = 0;
+        tasks[i].last_us = tasks[i].max_us = 0;
+    }
+}
+
+// Tarefa vencida de prazo mais antigo, ou -1
+static int most_overdue(const sched_t *s, uint32_t now) {
+    int best = -1;
+    int32_t best_late = -1;
+
+    for (size_t i = 0; i < s->count; i++) {
+        int32_t late = (int32_t)(now - s->tasks[i].next_due_us);
+        if (late >= 0 && late > best_late) {
+            best = (int)i;
+            best_late = late;
+        }
+    }
+    return best;
+}
+
+uint32_t sched_run(sched_t *s) {
+    uint32_t now = s->clock();
+    int i;
+
+    while ((i = most_overdue(s, now)) >= 0) {
+        sched_task_t *t = &s->tasks[i];
+
+        TRACE_BEGIN(TRACE_TASK, i);
+        t->run(now);
+        TRACE_END(TRACE_TASK, i);
+        uint32_t end = s->clock();
+        t->last_us = end - now;
+        if (t->last_us > t->max_us) t->max_us = t->last_us;
+        if (t->last_us > t->budget_us) t->overruns++;
+        t->runs++;
+
+        if (t->deferred) {
+            t->deferred = false;
+        } else {
+            t->next_due_us += t->period_us;
+            if ((int32_t)(end - t->next_due_us) >= (int32_t)t->period_us) {
+                t->missed++;
+                t->next_due_us = end + t->period_us;
+            }
+        }
+        now = end;
+    }
+
+    // Nada vencido: menor distância até um prazo
+    uint32_t wait = UINT32_MAX;
+    for (size_t k = 0; k < s->count; k++) {
+        uint32_t until = s->tasks[k].next_due_us - now;
+        if (until < wait) wait = until;
+    }
+    return s->count ? wait : 0;
+}
+
+void sched_trigger(sched_t *s, size_t index) {
+    if (index < s->count) s->tasks[index].next_due_us = s->clock();
+}
+
+void sched_trigger_at(sched_t *s, size_t index, uint32_t due_us) {
+    if (index >= s->count) return;
+    sched_task_t *t = &s->tasks[index];
+    if ((int32_t)(due_us - t->next_due_us) < 0) t->next_due_us = due_us;
+}
+
+void sched_defer(sched_t *s, size_t index, uint32_t delay_us) {
+    if (index >= s->count) return;
+    s->tasks[index].next_due_us = s->clock() + delay_us;
+    s->tasks[index].deferred = true;
+}
+
+uint32_t sched_total_overruns(const sched_t *s) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < s->count; i++) total += s->tasks[i].overruns;
+    return total;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file scheduler.h
+ * @brief Escalonador cooperativo por prazos do loop do núcleo 0
+ *
+ * Cada tarefa tem período e orçamento próprios. sched_run() executa as
+ * tarefas vencidas, sempre a de prazo mais antigo primeiro, e devolve quanto
+ * falta até o próximo prazo: o loop dorme exatamente isso, em vez de um
+ * sleep fixo depois de rodar tudo.
+ *
+ * O prazo seguinte é o anterior + período (sem deriva). Uma tarefa que
+ * atrasou um período inteiro conta como "missed" e volta a valer a partir de
+ * agora, sem rajada de execuções para recuperar. Execução acima do orçamento
+ * conta como overrun; as duas contagens saem por RPC (TP_RPC_GET_TASKS).
+ *
+ * Quem chama dorme em __wfe() até o prazo devolvido; eventos (telemetria
+ * nova, botão) acordam antes e usam sched_trigger() para a tarefa certa.
+ *
+ * Não depende do Pico SDK: o relógio vem de fora, como no elm327. Cada
+ * execução vira um par de eventos TRACE_TASK (trace.h); no host, compilar
+ * com -DTRACE_ENABLED=0.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*sched_fn)(uint32_t now_us);
+typedef uint32_t (*sched_clock_fn)(void);
+
+typedef struct {
+    const char *name;
+    sched_fn run;
+    uint32_t period_us;
+    uint32_t budget_us;
+
+    uint32_t next_due_us;
+    bool deferred;       // A própria tarefa escolheu o próximo prazo (sched_defer)
+    uint32_t runs;
+    uint32_t overruns;   // Execuções acima de budget_us
+    uint32_t missed;     // Prazos perdidos por um período inteiro ou mais
+    uint32_t last_us;    // Duração da última execução
+    uint32_t max_us;
+} sched_task_t;
+
+typedef struct {
+    sched_task_t *tasks;
+    size_t count;
+    sched_clock_fn clock;
+} sched_t;
+
+// Todas as tarefas vencem na primeira chamada de sched_run()
+void sched_init(sched_t *s, sched_task_t *tasks, size_t count, sched_clock_fn clock);
+
+// Roda as tarefas vencidas; retorna os us até o próximo prazo (0 = já tem outra vencida)
+uint32_t sched_run(sched_t *s);
+
+// Antecipa a tarefa para a próxima chamada de sched_run() (ex.: troca de tela)
+void sched_trigger(sched_t *s, size_t index);
+
+// Antecipa a tarefa para due_us, se for antes do prazo atual (due_us no passado = já)
+void sched_trigger_at(sched_t *s, size_t index, uint32_t due_us);
+
+// Chamada de dentro da tarefa: próximo prazo daqui a delay_us em vez de um
+// período depois do atual (ex.: LVGL diz quando precisa rodar de novo)
+void sched_defer(sched_t *s, size_t index, uint32_t delay_us);
+
+uint32_t sched_total_overruns(const sched_t *s);
+
+#endif // SCHEDULER_H
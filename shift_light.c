@@ -8,17 +8,34 @@
  * @copyright Copyright (c) 2025
  */
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
 #include "hardware/pio.h"
-#include "hardware/adc.h"
+#include "hardware/clocks.h"
 #include "ws2818b.pio.h"
 #include "play_audio.h"
 #include "lvgl.h"
 #include "lv_port_disp.h"
+#include "telemetry_proto.h"
+#include "usb_rx.h"
+#include "usb_link.h"
+#include "rpc.h"
+#include "latency.h"
+#include "telemetry.h"
+#include "sample_ring.h"
+#include "elm327.h"
+#include "elm327_uart.h"
+#include "can_rx.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "trace.h"
+#include "mem_stats.h"
+#include "cpu_load.h"
+#include "input.h"
 
 // DEFINIÇÕES E TIPOS GLOBAIS
 #define LED_COUNT 25
@@ -27,6 +44,27 @@
 const int vRx = 26;
 const int vRy = 27;
 #define MAX_IAT_TEMP 90 // Temperatura de Admissão do Ar máxima em °C
+#define STATUS_PERIOD_US 100000 // Período do quadro de status para o host
+#define SUBSCRIPTION_PERIOD_US 2000000 // Reenvio da assinatura, para um get_rpm.py que conectou depois
+#define STALE_MS_DEFAULT 2500 // > 2x o keyframe do get_rpm.py: canal sem atualização há mais que isso é velho
+#define RPC_CHANNELS_PAGE 6  // Canais por resposta de TP_RPC_GET_CHANNELS
+#define RPC_COUNTERS_PAGE 12 // Contadores por resposta de TP_RPC_GET_COUNTERS
+#define RPC_TASKS_PAGE 2     // Tarefas por resposta de TP_RPC_GET_TASKS (cabe no pior caso de varint)
+#define RPC_HISTORY_PAGE 6   // Amostras por resposta de TP_RPC_READ_HISTORY (cabe no pior caso de varint)
+#define RPC_TRACE_PAGE 8     // Eventos por resposta de TP_RPC_READ_TRACE (idem: dt 5 bytes + evento 4)
+#define RPC_BENCH_MAX_US 20000 // Tempo máximo de um benchmark RPC longe do loop do núcleo 0
+#define OBD_NATIVE_ELM327 0  // 1 = núcleo 1 lê o OBD direto de um ELM327 na UART0 (GP0/GP1), sem o get_rpm.py
+#define CAN_RX_ENABLED 0     // 1 = núcleo 1 também escuta o CAN do carro (transceiver no GP8, ver can_rx.h)
+#define LED_MIN_INTERVAL_US 2000 // Telemetria mais rápida que isso não redesenha os LEDs a cada publicação
+#define HUD_PERIOD_US 500000   // Janela das médias do HUD de desempenho
+#define USB_RX_STATS_PRINT 0 // 1 = imprime "RX_STATS,bytes/s,quadros/s,overruns,pico" na porta de logs a cada segundo
+
+_Static_assert(6 + PROF_BUCKETS <= TP_RPC_MAX_VALUES, "histograma de TP_RPC_GET_PROFILE não cabe numa resposta");
+_Static_assert(3 + 2 * RPC_TRACE_PAGE <= TP_RPC_MAX_VALUES, "página de TP_RPC_READ_TRACE não cabe numa resposta");
+_Static_assert((2 + 7 * RPC_TASKS_PAGE) * TP_VARINT_MAX_BYTES <= TP_RPC_RESPONSE_VALUE_BYTES,
+               "página de TP_RPC_GET_TASKS não cabe num quadro no pior caso");
+_Static_assert((2 + RPC_COUNTERS_PAGE) * TP_VARINT_MAX_BYTES <= TP_RPC_RESPONSE_VALUE_BYTES,
+               "página de TP_RPC_GET_COUNTERS não cabe num quadro no pior caso");
 
 struct pixel_t { uint8_t G, R, B; };
 typedef struct pixel_t pixel_t;
@@ -41,18 +79,27 @@ typedef enum {
 } ProgramState;
 
 // VARIÁVEIS GLOBAIS
-volatile int global_rpm = 0;
-volatile int global_speed = 0;
-volatile int global_iat = 0;
-volatile float global_fuel_rate_lph = 0.0; 
 volatile float global_km_per_liter = 0.0;
 volatile float brightness = 1.0;
 volatile int shift_light_rpm_target = 3500;
-static mutex_t lvgl_mutex;
+volatile uint32_t telemetry_stale_ms = STALE_MS_DEFAULT; // Ajustável por RPC (TP_PARAM_STALE_MS)
 
-volatile int global_coolant_temp = 0;
-volatile float global_timing_advance = 0.0;
-volatile float global_commanded_afr = 0.0;
+// Estado de telemetria do núcleo 1, publicado via telemetry_publish() após cada mensagem
+static telemetry_snapshot_t core1_state;
+static tp_rx_t core1_rx;
+static elm327_t core1_elm; // Só usado com OBD_NATIVE_ELM327; escrito só pelo núcleo 1
+// Tela cuja assinatura o cliente ELM327 deve seguir: o núcleo 0 escreve em
+// send_subscription() e o núcleo 1 aplica as taxas em core1_poll_elm()
+static volatile ProgramState elm_rate_state = STATE_MENU;
+
+static uint32_t leds_last_us = 0; // Início do último task_leds
+
+// Snapshot do núcleo 0: lido uma vez por passada do escalonador (ver
+// core0_refresh_telemetry), então LEDs, alertas, telas e rótulos da mesma
+// passada agem sobre a mesma publicação
+static telemetry_snapshot_t core0_tele;
+static uint32_t core0_tele_version = 0;
+static bool core0_tele_probe = false; // latency_frame_begin() da última leitura
 
 // Novas variáveis para o sistema de alertas
 volatile bool alert_active = false;
@@ -61,10 +108,31 @@ volatile char alert_message[32];
 
 ProgramState currentState = STATE_MENU;
 static int menu_selection = 0;
+
+// Canais que cada tela usa e a taxa desejada em centi-Hz (0 = não precisa).
+// RPM (LEDs) e IAT (alerta) valem em todas as telas; o resto só onde aparece.
+// Taxas abaixo de 1 Hz deixariam o canal velho (STALE_MS_DEFAULT) entre leituras.
+static const uint16_t subscription_chz[][CH_COUNT] = {
+    [STATE_MENU]                = { [CH_RPM] = 1000, [CH_IAT] = 100 },
+    [STATE_SHIFTLIGHT]          = { [CH_RPM] = 2000, [CH_SPEED] = 500, [CH_IAT] = 100, [CH_FUEL_RATE] = 200,
+                                    [CH_COOLANT] = 100, [CH_TIMING] = 500, [CH_AFR] = 500 },
+    [STATE_PERF_STATS]          = { [CH_RPM] = 1000, [CH_SPEED] = 2000, [CH_IAT] = 100 },
+    [STATE_FUEL_TEST]           = { [CH_RPM] = 1000, [CH_SPEED] = 500, [CH_IAT] = 100, [CH_FUEL_RATE] = 1000 },
+    [STATE_SETTINGS_SHIFTLIGHT] = { [CH_RPM] = 1000, [CH_IAT] = 100 },
+};
+
+// Sinais lidos direto do CAN do carro (CAN_RX_ENABLED), no formato do DBC.
+// IDs e posições de exemplo de um MQB: conferir com um log (candump) do
+// próprio carro antes de ligar. Chegam a 50-100 Hz, bem acima do OBD.
+static const can_signal_t can_signals[] = {
+    { .id = 0x0FD, .slot = CH_SPEED, .start_bit = 32, .length = 16, .mul = 1, .div = 100 }, // 0,01 km/h
+    { .id = 0x107, .slot = CH_RPM,   .start_bit = 16, .length = 16, .mul = 1, .div = 4 },   // 0,25 rpm
+};
 const int MENU_ITEM_COUNT = 4; 
 
 // Variáveis para o Teste 0-100
 bool perf_test_running = false;
+bool perf_test_armed = false; // Velocidade 0 atual vista: a próxima arrancada conta
 uint32_t perf_test_start_time = 0;
 float perf_test_result_time = 0.0;
 int perf_test_final_speed = 0;
@@ -86,285 +154,822 @@ lv_obj_t *ui_menu_title, *ui_menu_item1, *ui_menu_item2, *ui_menu_item3, *ui_men
 lv_obj_t *ui_status_label;
 lv_obj_t *ui_alert_screen; 
 lv_obj_t *ui_alert_label;  
+lv_obj_t *ui_hud, *ui_hud_cpu, *ui_hud_fps, *ui_hud_rx, *ui_hud_mem;
+static bool hud_enabled = false; // TP_PARAM_HUD
 
 // PROTÓTIPOS DE FUNÇÕES
 void npSetLED(const uint index, const uint8_t r, const uint8_t g, const uint8_t b);
 void npWrite();
 int getIndex(int x, int y);
 void npInit(uint pin);
-void setup_joystick();
 void create_ui();
 void update_menu_ui();
-bool lv_tick_callback(struct repeating_timer *t);
-bool read_line_from_stdio(char* buffer, int max_len);
+uint32_t lv_tick_ms(void);
+void core0_wait_events(uint32_t wait_us);
+void handle_message(tp_rx_t *rx, tp_rx_event_t ev);
+void apply_channel(int tag, int value, uint32_t t_us);
+void apply_sweep(const tp_sweep_t *sweep, uint32_t t_us);
+void apply_delta(const tp_delta_t *delta, uint32_t t_us);
 void atualizarMatriz(int rpm, float brightness);
 void core1_entry();
-void check_for_alerts();
-void calculate_instant_consumption();
+void core1_drain_usb();
+void core1_poll_elm();
+void core1_drain_can();
+void on_elm_value(void *ctx, uint8_t tag, int32_t value, uint32_t t_us);
+void check_for_alerts(const telemetry_snapshot_t *t);
+void calculate_instant_consumption(const telemetry_snapshot_t *t);
+void send_status();
+void send_subscription(ProgramState state);
+void send_control(const char *line);
+void handle_rpc(const tp_rpc_request_t *req);
+void set_label_fresh(lv_obj_t *label, bool fresh);
+void label_printf(lv_obj_t *label, const char *fmt, ...);
+void task_leds(uint32_t now_us);
+void task_input(uint32_t now_us);
+void task_lvgl(uint32_t now_us);
+void task_alerts(uint32_t now_us);
+void task_labels(uint32_t now_us);
+void task_link(uint32_t now_us);
+void task_status(uint32_t now_us);
+void task_subscription(uint32_t now_us);
+void task_hud(uint32_t now_us);
+void task_tests(uint32_t now_us);
+
+// Loop do núcleo 0: cada tarefa no seu período, com orçamento de tempo por execução.
+// Os períodos são o pior caso: telemetria nova, evento de entrada e RPC antecipam a tarefa
+// (ver core0_wait_events). A ordem do enum é a de TASK_NAMES em telemetry_proto.py.
+typedef enum {
+    TASK_LEDS = 0,
+    TASK_INPUT,
+    TASK_LVGL,
+    TASK_ALERTS,
+    TASK_LABELS,
+    TASK_LINK,
+    TASK_STATUS,
+    TASK_SUBSCRIPTION,
+    TASK_HUD,
+    TASK_TESTS,
+    TASK_COUNT
+} main_task_t;
+
+static sched_task_t main_tasks[TASK_COUNT] = {
+    [TASK_LEDS]         = { "leds",         task_leds,         100000,                 1500 },  // E a cada publicação; o período apaga RPM velho
+    [TASK_INPUT]        = { "input",        task_input,        50000,                  1000 },  // Consome a fila do input.h; eventos acordam pela IRQ
+    [TASK_LVGL]         = { "lvgl",         task_lvgl,         5000,                   20000 }, // Inclui o flush; o próximo prazo vem do LVGL
+    [TASK_ALERTS]       = { "alerts",       task_alerts,       50000,                  1000 },  // 20 Hz
+    [TASK_LABELS]       = { "labels",       task_labels,       100000,                 3000 },  // 10 Hz
+    [TASK_LINK]         = { "link",         task_link,         50000,                  2000 },  // E a cada RPC
+    [TASK_STATUS]       = { "status",       task_status,       STATUS_PERIOD_US,       500 },
+    [TASK_SUBSCRIPTION] = { "subscription", task_subscription, SUBSCRIPTION_PERIOD_US, 500 },
+    [TASK_HUD]          = { "hud",          task_hud,          HUD_PERIOD_US,          2000 },  // Só escreve com o HUD ligado
+    [TASK_TESTS]        = { "tests",        task_tests,        100000,                 1000 },  // E a cada publicação; o período detecta canal velho
+};
+static sched_t main_sched;
+static ProgramState subscribed_state = STATE_MENU; // Última tela enviada por send_subscription()
+
+// Canais de que cada tarefa depende; só redesenha o que mudou (ver telemetry_sub_t)
+static telemetry_sub_t leds_sub, alerts_sub, labels_sub;
+static uint32_t led_writes = 0;    // npWrite() feitos; com RPM parado, fica parado
+static uint32_t label_writes = 0;  // Rótulos reescritos por label_printf()
 
 // NÚCLEO 1 (DADOS)
 void core1_entry() {
+    mem_paint_stack();
     sleep_ms(10); 
-    char uart_buffer[64];
-    int tag_recebida, valor_recebido;
+    profile_init_core();
+
+    tp_rx_init(&core1_rx);
+#if OBD_NATIVE_ELM327
+    elm327_uart_init();
+    elm327_init(&core1_elm, elm327_uart_write, on_elm_value, NULL, time_us_32());
+    // Assinatura inicial; as trocas seguintes chegam por elm_rate_state
+    for (int slot = 0; slot < CH_COUNT; slot++) {
+        elm327_set_rate(&core1_elm, slot, subscription_chz[elm_rate_state][slot]);
+    }
+#endif
+#if CAN_RX_ENABLED
+    can_rx_init(can_signals, sizeof(can_signals) / sizeof(can_signals[0]));
+#endif
 
     while (1) {
-        if (read_line_from_stdio(uart_buffer, sizeof(uart_buffer))) {
-            if (sscanf(uart_buffer, "%d,%d", &tag_recebida, &valor_recebido) == 2) {
-                switch (tag_recebida) {
-                    case 1: multicore_fifo_push_blocking(valor_recebido); break;
-                    case 2: global_iat = valor_recebido; break;
-                    case 3: global_speed = valor_recebido; break;
-                    case 4: global_fuel_rate_lph = valor_recebido / 100.0f; break;
-                    case 5: global_coolant_temp = valor_recebido; break;
-                    case 6: global_timing_advance = valor_recebido / 10.0f; break; // Ex: Python envia 125, aqui vira 12.5
-                    case 7: global_commanded_afr = valor_recebido / 100.0f; break; // Ex: Python envia 1470, aqui vira 14.70
-                }
+#if OBD_NATIVE_ELM327
+        // Acorda com linha/prompt da UART, mensagem USB, quadro CAN, troca de
+        // assinatura ou no próximo prazo do cliente (PID vencido, timeout)
+        uint32_t wait_us = elm327_next_poll_us(&core1_elm, time_us_32());
+        if (wait_us > 0) {
+            cpu_idle_begin();
+            best_effort_wfe_or_timeout(make_timeout_time_us(wait_us));
+            cpu_idle_end();
+        }
+        PROF_BEGIN(elm);
+        TRACE_BEGIN(TRACE_ELM_POLL, 0);
+        core1_poll_elm();
+        TRACE_END(TRACE_ELM_POLL, 0);
+        PROF_END(elm, PROF_ELM_POLL);
+#elif CAN_RX_ENABLED
+        cpu_idle_begin();
+        __wfe(); // Mensagem USB completa ou quadro CAN da tabela de sinais
+        cpu_idle_end();
+#else
+        // Dorme em __wfe() até o IRQ USB sinalizar uma mensagem completa no ring
+        cpu_idle_begin();
+        usb_rx_wait_frame();
+        cpu_idle_end();
+#endif
+#if CAN_RX_ENABLED
+        PROF_BEGIN(can);
+        core1_drain_can();
+        PROF_END(can, PROF_CAN_DRAIN);
+#endif
+        // USB continua valendo para RPC e sondas de latência
+        PROF_BEGIN(usb);
+        core1_drain_usb();
+        PROF_END(usb, PROF_USB_DRAIN);
+    }
+}
+
+void core1_poll_elm() {
+    static ProgramState applied_state = STATE_MENU;
+    uint8_t chunk[64];
+    size_t n;
+
+    // Troca de tela no núcleo 0: só este núcleo escreve no cliente
+    ProgramState state = elm_rate_state;
+    if (state != applied_state) {
+        for (int slot = 0; slot < CH_COUNT; slot++) {
+            elm327_set_rate(&core1_elm, slot, subscription_chz[state][slot]);
+        }
+        applied_state = state;
+    }
+
+    while ((n = elm327_uart_read(chunk, sizeof(chunk))) > 0) {
+        uint32_t updates_before = core1_state.updates;
+        elm327_feed(&core1_elm, chunk, n, time_us_32());
+        // Uma publicação por resposta: os PIDs do mesmo pedido aparecem juntos no núcleo 0
+        if (core1_state.updates != updates_before) telemetry_publish(&core1_state);
+    }
+    elm327_poll(&core1_elm, time_us_32());
+}
+
+void core1_drain_can() {
+    can_rx_frame_t rx;
+    uint32_t updates_before = core1_state.updates;
+
+    while (can_rx_pop(&rx)) {
+        TRACE_INSTANT(TRACE_CAN_POP, rx.frame.id);
+        for (size_t i = 0; i < sizeof(can_signals) / sizeof(can_signals[0]); i++) {
+            int32_t value;
+            if (can_signal_decode(&can_signals[i], &rx.frame, &value)) {
+                apply_channel(channel_info[can_signals[i].slot].tag, value, rx.t_us);
             }
         }
-        sleep_ms(1);
+    }
+    if (core1_state.updates != updates_before) telemetry_publish(&core1_state);
+}
+
+void core1_drain_usb() {
+    uint8_t chunk[64];
+    size_t n;
+
+    while ((n = usb_rx_read(chunk, sizeof(chunk))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            tp_rx_event_t ev = tp_rx_feed(&core1_rx, chunk[i]);
+            if (ev != TP_RX_NONE) handle_message(&core1_rx, ev);
+        }
+    }
+}
+
+// Canal decodificado pelo cliente ELM327 nativo; mesmo caminho da telemetria do host
+void on_elm_value(void *ctx, uint8_t tag, int32_t value, uint32_t t_us) {
+    (void)ctx;
+    apply_channel(tag, value, t_us);
+}
+
+void handle_message(tp_rx_t *rx, tp_rx_event_t ev) {
+    tp_telemetry_t frame;
+    tp_sweep_t sweep;
+    tp_delta_t delta;
+    tp_rpc_request_t rpc;
+    tp_probe_t probe;
+    bool have_probe = false;
+    int tag_recebida;
+    int32_t valor_recebido;
+    uint32_t updates_before = core1_state.updates;
+    uint32_t now = time_us_32(); // Mesmo timestamp para todos os canais da mensagem
+
+    TRACE_BEGIN(TRACE_USB_MSG, ev == TP_RX_FRAME ? rx->payload[0] : 0);
+    if (ev == TP_RX_FRAME) {
+        // Quadro binário já validado (COBS + CRC); quadros corrompidos nem chegam aqui
+        switch (rx->payload[0]) {
+            case TP_MSG_TELEMETRY:
+                if (tp_parse_telemetry(rx->payload, rx->payload_len, &frame)) {
+                    for (int i = 0; i < frame.count; i++) {
+                        apply_channel(frame.ch[i].tag, frame.ch[i].value, now);
+                    }
+                    usb_rx_count_frame();
+                }
+                break;
+            case TP_MSG_SWEEP:
+                if (tp_parse_sweep(rx->payload, rx->payload_len, &sweep)) {
+                    apply_sweep(&sweep, now);
+                    usb_rx_count_frame();
+                }
+                break;
+            case TP_MSG_DELTA:
+                if (tp_parse_delta(rx->payload, rx->payload_len, &delta)) {
+                    apply_delta(&delta, now);
+                    usb_rx_count_frame();
+                }
+                break;
+            case TP_MSG_PROBE:
+                if (tp_parse_probe(rx->payload, rx->payload_len, &probe)) {
+                    for (int i = 0; i < probe.count; i++) {
+                        apply_channel(probe.ch[i].tag, probe.ch[i].value, now);
+                    }
+                    have_probe = true;
+                    usb_rx_count_frame();
+                }
+                break;
+            case TP_MSG_RPC_REQUEST:
+                // Executada pelo núcleo 0 (handle_rpc), dono dos parâmetros e do histórico
+                if (tp_parse_rpc_request(rx->payload, rx->payload_len, &rpc)) {
+                    rpc_post(&rpc);
+                    usb_rx_count_frame();
+                }
+                break;
+        }
+    } else if (tp_parse_sweep_line(rx->line, &sweep)) {
+        apply_sweep(&sweep, now);
+        usb_rx_count_frame();
+    } else if (tp_parse_delta_line(rx->line, &delta)) {
+        apply_delta(&delta, now);
+        usb_rx_count_frame();
+    } else if (tp_parse_tag_value(rx->line, &tag_recebida, &valor_recebido)) {
+        // Protocolo de texto antigo, mantido por compatibilidade
+        apply_channel(tag_recebida, valor_recebido, now);
+        usb_rx_count_frame();
+    }
+
+    // Uma publicação por mensagem: a varredura inteira aparece de uma vez no núcleo 0
+    if (core1_state.updates != updates_before) {
+        telemetry_publish(&core1_state);
+    }
+    if (have_probe) {
+        // Depois da publicação: o núcleo 0 que enxergar a sonda já lê o snapshot com ela
+        latency_probe_post(probe.seq, probe.obd_age_us, now, time_us_32());
+    }
+    TRACE_END(TRACE_USB_MSG, 0);
+}
+
+void apply_channel(int tag, int value, uint32_t t_us) {
+    // Tag -> slot/escala vem da tabela gerada de channels.csv; tag desconhecida é ignorada
+    if (tag < 0 || tag > 255) return;
+    if (telemetry_apply(&core1_state, (uint8_t)tag, value, t_us) == CH_NONE) return;
+    TRACE_INSTANT(TRACE_SAMPLE, tag);
+
+    // Histórico completo para o núcleo 0; com o ring cheio a amostra é descartada, nunca bloqueia
+    sample_ring_push((uint8_t)tag, value, t_us);
+}
+
+// Aplica a varredura inteira de uma vez, sem intercalar outras mensagens:
+// todos os canais na tela vêm da mesma leitura OBD
+void apply_sweep(const tp_sweep_t *sweep, uint32_t t_us) {
+    core1_state.host_ms = sweep->host_ms;
+    int count = sweep->count < CH_SWEEP_COUNT ? sweep->count : CH_SWEEP_COUNT;
+    for (int i = 0; i < count; i++) {
+        apply_channel(channel_info[channel_sweep_slots[i]].tag, sweep->value[i], t_us);
+    }
+}
+
+// Só os canais que mudaram; os demais mantêm o valor do último keyframe/delta
+void apply_delta(const tp_delta_t *delta, uint32_t t_us) {
+    core1_state.host_ms = delta->host_ms;
+    for (int i = 0; i < CH_SWEEP_COUNT; i++) {
+        if (delta->mask & (1u << i)) {
+            apply_channel(channel_info[channel_sweep_slots[i]].tag, delta->value[i], t_us);
+        }
     }
 }
 
 // FUNÇÃO MAIN (NÚCLEO 0)
 int main() {
+    mem_paint_stack(); // Antes de tudo: a pilha ainda está rasa
+    usb_rx_init();
     stdio_init_all();
+    profile_init_core();
+    usb_link_init();
     sleep_ms(2500);
 
-    mutex_init(&lvgl_mutex);
     lv_init();
     lv_port_disp_init();
-    static struct repeating_timer timer;
-    add_repeating_timer_ms(-5, lv_tick_callback, NULL, &timer);
+    lv_tick_set_cb(lv_tick_ms); // Sem timer periódico acordando o núcleo só para contar ms
 
-    setup_joystick();
+    input_init(SW, vRx, vRy);
     npInit(LED_PIN);
     create_ui();
     
-    multicore_fifo_clear_irq();
     multicore_launch_core1(core1_entry);
 
-    bool sw_pressed_last_frame = false;
-    uint32_t last_joystick_time = 0;
-    uint32_t last_display_update_time = 0;
-    
+    telemetry_sub_init(&leds_sub, TELEMETRY_BIT(CH_RPM));
+    telemetry_sub_init(&alerts_sub, TELEMETRY_BIT(CH_IAT) | TELEMETRY_BIT(CH_SPEED) | TELEMETRY_BIT(CH_FUEL_RATE));
+    telemetry_sub_init(&labels_sub, TELEMETRY_BIT(CH_RPM) | TELEMETRY_BIT(CH_IAT) | TELEMETRY_BIT(CH_SPEED) |
+                                    TELEMETRY_BIT(CH_FUEL_RATE) | TELEMETRY_BIT(CH_COOLANT) |
+                                    TELEMETRY_BIT(CH_TIMING) | TELEMETRY_BIT(CH_AFR));
+    sched_init(&main_sched, main_tasks, TASK_COUNT, time_us_32);
+
     while (1) {
-        mutex_enter_blocking(&lvgl_mutex);
-        lv_timer_handler();
-        mutex_exit(&lvgl_mutex);
-        
-        while (multicore_fifo_rvalid()) {
-            global_rpm = multicore_fifo_pop_blocking();
-        }
-        check_for_alerts();
-        calculate_instant_consumption();
-
-        atualizarMatriz(global_rpm, brightness);
-        
-        mutex_enter_blocking(&lvgl_mutex);
-        if (alert_active) {
-            // Se o alerta está ativo, mostra a tela e atualiza a mensagem
-            if (lv_obj_has_flag(ui_alert_screen, LV_OBJ_FLAG_HIDDEN)) {
-                lv_obj_clear_flag(ui_alert_screen, LV_OBJ_FLAG_HIDDEN);
-            }
-            lv_label_set_text(ui_alert_label, (const char*)alert_message);
+        // Cada tarefa no seu período; dorme até o próximo prazo ou até um evento
+        uint32_t wait_us = sched_run(&main_sched);
+        core0_wait_events(wait_us);
+    }
+    return 0;
+}
+
+// Atualiza core0_tele se houve publicação desde a última leitura; devolve a
+// versão lida. A sonda de latência é tomada antes da leitura (ver latency.h):
+// a publicação que a acompanha já está na versão lida em seguida.
+static uint32_t core0_refresh_telemetry(void) {
+    core0_tele_probe = latency_frame_begin();
+    uint32_t version = telemetry_version();
+    if (version != core0_tele_version) {
+        telemetry_read(&core0_tele);
+        core0_tele_version = version;
+    }
+    return version;
+}
+
+// Dorme em __wfe() até o prazo do escalonador. Acordam antes: __sev() de
+// telemetry_publish() e rpc_post() no núcleo 1, IRQs do input.h e do USB. Um
+// evento que chega enquanto as tarefas rodam fica no registrador de eventos
+// e o __wfe() seguinte retorna na hora, então nenhum se perde.
+void core0_wait_events(uint32_t wait_us) {
+    static uint32_t leds_version = 0;
+    static uint32_t tests_version = 0;
+
+    if (wait_us > 0) {
+        cpu_idle_begin();
+        best_effort_wfe_or_timeout(make_timeout_time_us(wait_us));
+        cpu_idle_end();
+    }
+
+    uint32_t version = core0_refresh_telemetry();
+    if (version != leds_version) {
+        // No máximo um redesenho por LED_MIN_INTERVAL_US, sem perder a última amostra
+        sched_trigger_at(&main_sched, TASK_LEDS, leds_last_us + LED_MIN_INTERVAL_US);
+        leds_version = version;
+    }
+    if (version != tests_version) {
+        sched_trigger(&main_sched, TASK_TESTS); // Cada amostra de velocidade/consumo conta
+        tests_version = version;
+    }
+    if (input_pending()) sched_trigger(&main_sched, TASK_INPUT);
+    if (rpc_pending()) sched_trigger(&main_sched, TASK_LINK);
+}
+
+
+// TAREFAS DO NÚCLEO 0 (ver main_tasks)
+
+// LEDs com a telemetria mais recente; é o caminho medido pela sonda de latência
+void task_leds(uint32_t now_us) {
+    const telemetry_snapshot_t *tele = &core0_tele;
+
+    leds_last_us = now_us;
+    bool probe = core0_tele_probe;
+    uint32_t now = time_us_32();
+    uint32_t stale_us = telemetry_stale_ms * 1000u;
+
+    // RPM igual e com o mesmo frescor: a matriz já mostra isso
+    if (!telemetry_sub_poll(&leds_sub, tele, now, stale_us) && !probe) return;
+
+    // RPM velho (BLE caiu, PID sem resposta): LEDs apagados em vez de um shift light congelado
+    bool rpm_fresh = telemetry_is_fresh(tele, CH_RPM, now, stale_us);
+    atualizarMatriz(rpm_fresh ? tele->ch[CH_RPM] : 0, brightness);
+    led_writes++;
+    latency_led_written(time_us_32(), lv_port_disp_frame_count());
+}
+
+void task_lvgl(uint32_t now_us) {
+    (void)now_us;
+    PROF_BEGIN(lvgl);
+    uint32_t idle_ms = lv_timer_handler();
+    PROF_END(lvgl, PROF_LVGL);
+    latency_poll(lv_port_disp_frame_count(), lv_port_disp_last_frame_us(), time_us_32());
+
+    // Dorme até o próximo timer do LVGL (refresh a cada LV_DEF_REFR_PERIOD), não a cada 5 ms
+    if (idle_ms > LV_DEF_REFR_PERIOD) idle_ms = LV_DEF_REFR_PERIOD;
+    sched_defer(&main_sched, TASK_LVGL, idle_ms * 1000u);
+}
+
+void task_alerts(uint32_t now_us) {
+    static bool alert_shown = false;
+    const telemetry_snapshot_t *tele = &core0_tele;
+
+    (void)now_us;
+    uint32_t now = time_us_32();
+    uint32_t stale_us = telemetry_stale_ms * 1000u;
+    uint32_t dirty = telemetry_sub_poll(&alerts_sub, tele, now, stale_us);
+
+    // Alertas e consumo só com dados atuais; valor velho não dispara nem zera nada
+    if ((dirty & TELEMETRY_BIT(CH_IAT)) && telemetry_is_fresh(tele, CH_IAT, now, stale_us)) {
+        check_for_alerts(tele);
+    }
+    if (dirty & (TELEMETRY_BIT(CH_SPEED) | TELEMETRY_BIT(CH_FUEL_RATE))) {
+        if (telemetry_is_fresh(tele, CH_SPEED, now, stale_us) &&
+            telemetry_is_fresh(tele, CH_FUEL_RATE, now, stale_us)) {
+            calculate_instant_consumption(tele);
         } else {
-            // Se não há alerta, garante que a tela está escondida
-            if (!lv_obj_has_flag(ui_alert_screen, LV_OBJ_FLAG_HIDDEN)) {
-                lv_obj_add_flag(ui_alert_screen, LV_OBJ_FLAG_HIDDEN);
-            }
+            global_km_per_liter = 0.0;
         }
-        mutex_exit(&lvgl_mutex);
+    }
 
-        bool sw_is_pressed_now = !gpio_get(SW);
+    // A mensagem só é escrita quando o alerta liga (check_for_alerts)
+    if (alert_active == alert_shown) return;
+    if (alert_active) {
+        lv_label_set_text(ui_alert_label, (const char*)alert_message);
+        lv_obj_clear_flag(ui_alert_screen, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(ui_alert_screen, LV_OBJ_FLAG_HIDDEN);
+    }
+    alert_shown = alert_active;
+}
 
-        if (fuel_test_running) {
-            uint32_t now = time_us_32();
-            if (last_fuel_calc_time > 0) {
-                uint32_t delta_t_us = now - last_fuel_calc_time;
-                double delta_t_hours = (double)delta_t_us / 3600000000.0;
-                total_fuel_consumed_liters += global_fuel_rate_lph * delta_t_hours;
-            }
-            last_fuel_calc_time = now;
-        }
-
-        switch (currentState) {
-            case STATE_MENU: {
-                if (sw_is_pressed_now && !sw_pressed_last_frame) {
-                    if (menu_selection == 0) {
-                        currentState = STATE_SHIFTLIGHT;
-                        lv_label_set_text(ui_status_label, "MONITOR");
-                    } else if (menu_selection == 1) {
-                        currentState = STATE_PERF_STATS;
-                        perf_test_result_time = 0.0;
-                        perf_test_final_speed = 0;
-                        lv_label_set_text(ui_status_label, "TESTE 0-100");
-                    } else if (menu_selection == 2) {
-                        currentState = STATE_FUEL_TEST;
-                        lv_label_set_text(ui_status_label, "TESTE CONSUMO");
-                    }else if (menu_selection == 3) { 
-                        currentState = STATE_SETTINGS_SHIFTLIGHT;
-                        lv_label_set_text(ui_status_label, "AJUSTE RPM");
-                    }
-                    
-                    lv_obj_add_flag(ui_menu_screen, LV_OBJ_FLAG_HIDDEN);
-                    lv_obj_clear_flag(ui_data_screen, LV_OBJ_FLAG_HIDDEN);
-                }
+// Eventos do botão e do joystick (input.h) e a máquina de estados das telas
+void task_input(uint32_t now_us) {
+    const telemetry_snapshot_t *tele = &core0_tele;
 
-                if (time_us_32() - last_joystick_time > 200000) {
-                    adc_select_input(1);
-                    uint16_t joy_y = adc_read();
-                    if (joy_y > 3000) {
-                        menu_selection = (menu_selection + 1) % MENU_ITEM_COUNT;
-                        update_menu_ui();
-                    } else if (joy_y < 1000) {
-                        menu_selection = (menu_selection == 0) ? MENU_ITEM_COUNT - 1 : menu_selection - 1;
-                        update_menu_ui();
-                    }
-                    last_joystick_time = time_us_32();
+    (void)now_us;
+    uint32_t now = time_us_32();
+
+    // Um evento por execução; sobrando na fila, a tarefa é antecipada de novo
+    input_event_t ev = INPUT_NONE;
+    input_pop(&ev);
+    bool clicked = ev == INPUT_CLICK;
+
+    // Segurar o botão liga/desliga o HUD de desempenho em qualquer tela
+    if (ev == INPUT_LONG_PRESS) {
+        hud_enabled = !hud_enabled;
+        sched_trigger(&main_sched, TASK_HUD);
+    }
+
+    switch (currentState) {
+        case STATE_MENU: {
+            if (clicked) {
+                if (menu_selection == 0) {
+                    currentState = STATE_SHIFTLIGHT;
+                    lv_label_set_text(ui_status_label, "MONITOR");
+                } else if (menu_selection == 1) {
+                    currentState = STATE_PERF_STATS;
+                    perf_test_result_time = 0.0;
+                    perf_test_final_speed = 0;
+                    lv_label_set_text(ui_status_label, "TESTE 0-100");
+                } else if (menu_selection == 2) {
+                    currentState = STATE_FUEL_TEST;
+                    lv_label_set_text(ui_status_label, "TESTE CONSUMO");
+                }else if (menu_selection == 3) { 
+                    currentState = STATE_SETTINGS_SHIFTLIGHT;
+                    lv_label_set_text(ui_status_label, "AJUSTE RPM");
                 }
-                break;
+
+                lv_obj_add_flag(ui_menu_screen, LV_OBJ_FLAG_HIDDEN);
+                lv_obj_clear_flag(ui_data_screen, LV_OBJ_FLAG_HIDDEN);
+            }
+
+            if (ev == INPUT_UP) {
+                menu_selection = (menu_selection + 1) % MENU_ITEM_COUNT;
+                update_menu_ui();
+            } else if (ev == INPUT_DOWN) {
+                menu_selection = (menu_selection == 0) ? MENU_ITEM_COUNT - 1 : menu_selection - 1;
+                update_menu_ui();
             }
+            break;
+        }
 
-            case STATE_SHIFTLIGHT: {
-                if (sw_is_pressed_now && !sw_pressed_last_frame) {
+        case STATE_SHIFTLIGHT: {
+            if (clicked) {
+                currentState = STATE_MENU;
+                lv_label_set_text(ui_status_label, "MENU");
+                lv_obj_clear_flag(ui_menu_screen, LV_OBJ_FLAG_HIDDEN);
+                lv_obj_add_flag(ui_data_screen, LV_OBJ_FLAG_HIDDEN);
+
+                // Os mesmos rótulos são reaproveitados pelas outras telas
+                set_label_fresh(ui_rpm_label, true);
+                set_label_fresh(ui_iat_label, true);
+                set_label_fresh(ui_speed_label, true);
+                set_label_fresh(ui_coolant_label, true);
+                set_label_fresh(ui_timing_label, true);
+                set_label_fresh(ui_afr_label, true);
+            }
+            break;
+        }
+
+        case STATE_PERF_STATS: {
+            if (clicked) {
+                if (perf_test_running) {
+                    // Fecha na última amostra de velocidade, a mesma do valor final
+                    perf_test_running = false;
+                    perf_test_result_time = (tele->t_us[CH_SPEED] - perf_test_start_time) / 1000000.0f;
+                    perf_test_final_speed = tele->ch[CH_SPEED];
+                } else {
                     currentState = STATE_MENU;
                     lv_label_set_text(ui_status_label, "MENU");
                     lv_obj_clear_flag(ui_menu_screen, LV_OBJ_FLAG_HIDDEN);
                     lv_obj_add_flag(ui_data_screen, LV_OBJ_FLAG_HIDDEN);
                 }
-                 if (time_us_32() - last_display_update_time > 100000) {
-                    lv_label_set_text_fmt(ui_rpm_label, "RPM: %d", global_rpm);
-                    lv_label_set_text_fmt(ui_iat_label, "IAT: %d C", global_iat);
-                    lv_label_set_text_fmt(ui_speed_label, "Velocidade: %d km/h", global_speed);
-                    lv_label_set_text_fmt(ui_coolant_label, "Arref.: %d C", global_coolant_temp);
-                    lv_label_set_text_fmt(ui_timing_label, "Avanço: %.1f", global_timing_advance);
-                    lv_label_set_text_fmt(ui_afr_label, "AFR Cmd: %.2f", global_commanded_afr);
-                    last_display_update_time = time_us_32();
-                }
-                break;
             }
-            
-            case STATE_PERF_STATS: {
-                if (sw_is_pressed_now && !sw_pressed_last_frame) {
-                    if (perf_test_running) {
-                        perf_test_running = false;
-                        uint32_t tempo_fim_teste = time_us_32();
-                        perf_test_result_time = (tempo_fim_teste - perf_test_start_time) / 1000000.0f;
-                        perf_test_final_speed = global_speed; 
-                    } else {
+            break;
+        }
+
+        case STATE_FUEL_TEST: {
+            if (clicked) {
+                if (fuel_test_running) {
+                    fuel_test_running = false;
+                    last_fuel_calc_time = 0;
+                    send_control("STOP_LOG\n");
+                } else {
+                    if (total_fuel_consumed_liters > 0.0) {
                         currentState = STATE_MENU;
+                        total_fuel_consumed_liters = 0.0;
                         lv_label_set_text(ui_status_label, "MENU");
                         lv_obj_clear_flag(ui_menu_screen, LV_OBJ_FLAG_HIDDEN);
                         lv_obj_add_flag(ui_data_screen, LV_OBJ_FLAG_HIDDEN);
-                    }
-                }
-
-                if (!perf_test_running && global_speed > 0 && perf_test_result_time == 0.0) { perf_test_running = true; perf_test_start_time = time_us_32(); printf("START_LOG\n"); }
-                if (perf_test_running && global_speed >= 100) { perf_test_running = false; uint32_t tempo_fim_teste = time_us_32(); perf_test_result_time = (tempo_fim_teste - perf_test_start_time) / 1000000.0f; perf_test_final_speed = 100;printf("STOP_LOG\n"); }
-                if (perf_test_running && global_speed == 0) { perf_test_running = false; perf_test_result_time = 0.0; printf("STOP_LOG\n"); }
-
-                if (time_us_32() - last_display_update_time > 100000) {
-                    if (perf_test_running) { float tempo_parcial = (time_us_32() - perf_test_start_time) / 1000000.0f; lv_label_set_text_fmt(ui_rpm_label, "Tempo: %.2f s", tempo_parcial); lv_label_set_text(ui_iat_label, "Clique para PARAR");
                     } else {
-                         if (perf_test_result_time > 0.0) { lv_label_set_text_fmt(ui_rpm_label, "0-%d: %.2f s", perf_test_final_speed, perf_test_result_time); lv_label_set_text(ui_iat_label, "Clique para MENU"); } 
-                         else { lv_label_set_text(ui_rpm_label, "Aguardando..."); lv_label_set_text(ui_iat_label, "Acelere para iniciar."); }
+                        fuel_test_running = true;
+                        total_fuel_consumed_liters = 0.0;
+                        fuel_test_start_time = now;
+                        last_fuel_calc_time = now;
                     }
-                    lv_label_set_text_fmt(ui_speed_label, "Velocidade: %d km/h", global_speed);
-                    last_display_update_time = time_us_32();
                 }
-                break;
+            }
+            break;
+        }
+        case STATE_SETTINGS_SHIFTLIGHT: {
+            // Lógica de entrada/saída
+            if (clicked) {
+                currentState = STATE_MENU; // Volta ao menu
+                lv_label_set_text(ui_status_label, "MENU");
+                lv_obj_clear_flag(ui_menu_screen, LV_OBJ_FLAG_HIDDEN);
+                lv_obj_add_flag(ui_data_screen, LV_OBJ_FLAG_HIDDEN);
             }
 
-            case STATE_FUEL_TEST: {
-                if (sw_is_pressed_now && !sw_pressed_last_frame) {
-                    if (fuel_test_running) {
-                        fuel_test_running = false;
-                        last_fuel_calc_time = 0;
-                        printf("STOP_LOG\n");
-                    } else {
-                        if (total_fuel_consumed_liters > 0.0) {
-                            currentState = STATE_MENU;
-                            total_fuel_consumed_liters = 0.0;
-                            lv_label_set_text(ui_status_label, "MENU");
-                            lv_obj_clear_flag(ui_menu_screen, LV_OBJ_FLAG_HIDDEN);
-                            lv_obj_add_flag(ui_data_screen, LV_OBJ_FLAG_HIDDEN);
-                        } else {
-                            fuel_test_running = true;
-                            total_fuel_consumed_liters = 0.0;
-                            fuel_test_start_time = time_us_32();
-                            last_fuel_calc_time = time_us_32();
-                        }
-                    }
+            // Joystick ajusta o valor; segurado, o input.h repete o evento
+            if (ev == INPUT_UP || ev == INPUT_DOWN) {
+                if (ev == INPUT_UP) { // Para cima
+                    shift_light_rpm_target += 100;
+                    if (shift_light_rpm_target > 9000) shift_light_rpm_target = 9000;
+                } else { // Para baixo
+                    shift_light_rpm_target -= 100;
+                    if (shift_light_rpm_target < 1000) shift_light_rpm_target = 1000;
                 }
+                telemetry_sub_invalidate(&leds_sub);
+                sched_trigger(&main_sched, TASK_LEDS);
+            }
+            break;
+        }
+    }
 
-                if (time_us_32() - last_display_update_time > 100000) {
-                    if (fuel_test_running) {
-                        uint32_t elapsed_time_ms = (time_us_32() - fuel_test_start_time) / 1000;
-                        int minutes = elapsed_time_ms / 60000;
-                        int seconds = (elapsed_time_ms % 60000) / 1000;
-                        
-                        lv_label_set_text_fmt(ui_rpm_label, "Tempo: %02d:%02d", minutes, seconds);
-                        lv_label_set_text_fmt(ui_iat_label, "Gasto: %.3f L", total_fuel_consumed_liters);
-                        lv_label_set_text(ui_speed_label, "Clique para PARAR");
-                    } else {
-                         if (total_fuel_consumed_liters > 0.0) {
-                            uint32_t elapsed_time_ms = (last_fuel_calc_time > 0) ? (last_fuel_calc_time - fuel_test_start_time) / 1000 : 0;
-                            int minutes = elapsed_time_ms / 60000;
-                            int seconds = (elapsed_time_ms % 60000) / 1000;
-
-                            lv_label_set_text_fmt(ui_rpm_label, "Final: %02d:%02d", minutes, seconds);
-                            lv_label_set_text_fmt(ui_iat_label, "Total: %.3f L", total_fuel_consumed_liters);
-                            lv_label_set_text(ui_speed_label, "Clique para MENU");
-
-                         } else {
-                            lv_label_set_text(ui_rpm_label, "Pronto para iniciar");
-                            lv_label_set_text_fmt(ui_iat_label, "Consumo: %.1f L/h", global_fuel_rate_lph);
-                            lv_label_set_text(ui_speed_label, "Clique para INICIAR");
-                         }
-                    }
-                    last_display_update_time = time_us_32();
-                }
-                break;
+    // Troca de tela: rótulos na hora e o host passa a ler só o que a tela nova usa
+    if (currentState != subscribed_state) {
+        telemetry_sub_invalidate(&labels_sub);
+        sched_trigger(&main_sched, TASK_LABELS);
+        sched_trigger(&main_sched, TASK_SUBSCRIPTION);
+    }
+    if (input_pending()) sched_defer(&main_sched, TASK_INPUT, 0);
+}
+
+// Cronômetro do 0-100 e integração do consumo. Roda a cada publicação e mede
+// pelo instante de cada amostra (t_us do núcleo 1), não pela hora da tarefa
+void task_tests(uint32_t now_us) {
+    const telemetry_snapshot_t *tele = &core0_tele;
+
+    (void)now_us;
+    uint32_t now = time_us_32();
+    uint32_t stale_us = telemetry_stale_ms * 1000u;
+
+    if (fuel_test_running && telemetry_is_fresh(tele, CH_FUEL_RATE, now, stale_us)) {
+        // Só amostra nova; um buraco maior que o limite de canal velho não é
+        // integrado: o teste fica pausado até o canal voltar
+        uint32_t t = tele->t_us[CH_FUEL_RATE];
+        int32_t delta_t_us = (int32_t)(t - last_fuel_calc_time);
+        if (delta_t_us > 0) {
+            if ((uint32_t)delta_t_us <= stale_us) {
+                double delta_t_hours = (double)delta_t_us / 3600000000.0;
+                total_fuel_consumed_liters += telemetry_value_f(tele, CH_FUEL_RATE) * delta_t_hours;
             }
-            case STATE_SETTINGS_SHIFTLIGHT: {
-                // Lógica de entrada/saída
-                if (sw_is_pressed_now && !sw_pressed_last_frame) {
-                    currentState = STATE_MENU; // Volta ao menu
-                    lv_label_set_text(ui_status_label, "MENU");
-                    lv_obj_clear_flag(ui_menu_screen, LV_OBJ_FLAG_HIDDEN);
-                    lv_obj_add_flag(ui_data_screen, LV_OBJ_FLAG_HIDDEN);
-                }
+            last_fuel_calc_time = t;
+        }
+    }
 
-                // Lógica do Joystick para ajustar valor
-                if (time_us_32() - last_joystick_time > 150000) { // Tempo de resposta menor
-                    adc_select_input(1); // Eixo Y
-                    uint16_t joy_y = adc_read();
-                    if (joy_y > 3000) { // Para cima
-                        shift_light_rpm_target += 100;
-                        if (shift_light_rpm_target > 9000) shift_light_rpm_target = 9000;
-                    } else if (joy_y < 1000) { // Para baixo
-                        shift_light_rpm_target -= 100;
-                        if (shift_light_rpm_target < 1000) shift_light_rpm_target = 1000;
-                    }
-                    last_joystick_time = time_us_32();
-                }
+    if (currentState != STATE_PERF_STATS) return;
 
-                // Atualiza a tela
-                if (time_us_32() - last_display_update_time > 100000) {
-                    lv_label_set_text_fmt(ui_rpm_label, "RPM Alvo: %d", shift_light_rpm_target);
-                    lv_label_set_text(ui_iat_label, "Use o joystick para alterar");
-                    lv_label_set_text(ui_speed_label, "Clique para salvar e voltar");
-                    last_display_update_time = time_us_32();
-                }
-                break;
+    // Velocidade velha no meio da corrida: o tempo medido inclui a falha e
+    // não vale; o teste é cancelado e só rearma com o carro parado de novo
+    if (!telemetry_is_fresh(tele, CH_SPEED, now, stale_us)) {
+        if (perf_test_running) { perf_test_running = false; perf_test_result_time = 0.0; send_control("STOP_LOG\n"); }
+        perf_test_armed = false;
+        return;
+    }
+
+    int32_t speed = tele->ch[CH_SPEED];
+    uint32_t t = tele->t_us[CH_SPEED];
+    if (!perf_test_running) {
+        if (speed == 0) {
+            perf_test_armed = true;
+        } else if (perf_test_armed && perf_test_result_time == 0.0) {
+            // Primeira amostra em movimento abre o cronômetro
+            perf_test_armed = false;
+            perf_test_running = true;
+            perf_test_start_time = t;
+            send_control("START_LOG\n");
+        }
+    } else if (speed >= 100) {
+        perf_test_running = false;
+        perf_test_result_time = (t - perf_test_start_time) / 1000000.0f;
+        perf_test_final_speed = 100;
+        send_control("STOP_LOG\n");
+    } else if (speed == 0) {
+        perf_test_running = false;
+        perf_test_result_time = 0.0;
+        send_control("STOP_LOG\n");
+    }
+}
+
+void task_labels(uint32_t now_us) {
+    const telemetry_snapshot_t *tele = &core0_tele;
+
+    (void)now_us;
+    uint32_t now = time_us_32();
+    uint32_t stale_us = telemetry_stale_ms * 1000u;
+    uint32_t dirty = telemetry_sub_poll(&labels_sub, tele, now, stale_us);
+
+    switch (currentState) {
+        case STATE_SHIFTLIGHT: {
+            // Só telemetria nesta tela: formata apenas os canais que mudaram
+            if (dirty & TELEMETRY_BIT(CH_RPM)) {
+                set_label_fresh(ui_rpm_label, telemetry_is_fresh(tele, CH_RPM, now, stale_us));
+                label_printf(ui_rpm_label, "RPM: %d", tele->ch[CH_RPM]);
+            }
+            if (dirty & TELEMETRY_BIT(CH_IAT)) {
+                set_label_fresh(ui_iat_label, telemetry_is_fresh(tele, CH_IAT, now, stale_us));
+                label_printf(ui_iat_label, "IAT: %d C", tele->ch[CH_IAT]);
+            }
+            if (dirty & TELEMETRY_BIT(CH_SPEED)) {
+                set_label_fresh(ui_speed_label, telemetry_is_fresh(tele, CH_SPEED, now, stale_us));
+                label_printf(ui_speed_label, "Velocidade: %d km/h", tele->ch[CH_SPEED]);
+            }
+            if (dirty & TELEMETRY_BIT(CH_COOLANT)) {
+                set_label_fresh(ui_coolant_label, telemetry_is_fresh(tele, CH_COOLANT, now, stale_us));
+                label_printf(ui_coolant_label, "Arref.: %d C", tele->ch[CH_COOLANT]);
             }
+            if (dirty & TELEMETRY_BIT(CH_TIMING)) {
+                set_label_fresh(ui_timing_label, telemetry_is_fresh(tele, CH_TIMING, now, stale_us));
+                label_printf(ui_timing_label, "Avanço: %.1f", telemetry_value_f(tele, CH_TIMING));
+            }
+            if (dirty & TELEMETRY_BIT(CH_AFR)) {
+                set_label_fresh(ui_afr_label, telemetry_is_fresh(tele, CH_AFR, now, stale_us));
+                label_printf(ui_afr_label, "AFR Cmd: %.2f", telemetry_value_f(tele, CH_AFR));
+            }
+            break;
+        }
+        case STATE_PERF_STATS: {
+            if (perf_test_running) { float tempo_parcial = (time_us_32() - perf_test_start_time) / 1000000.0f; label_printf(ui_rpm_label, "Tempo: %.2f s", tempo_parcial); label_printf(ui_iat_label, "Clique para PARAR");
+            } else {
+                 if (perf_test_result_time > 0.0) { label_printf(ui_rpm_label, "0-%d: %.2f s", perf_test_final_speed, perf_test_result_time); label_printf(ui_iat_label, "Clique para MENU"); } 
+                 else { label_printf(ui_rpm_label, "Aguardando..."); label_printf(ui_iat_label, "Acelere para iniciar."); }
+            }
+            label_printf(ui_speed_label, "Velocidade: %d km/h", tele->ch[CH_SPEED]);
+            break;
+        }
+        case STATE_FUEL_TEST: {
+            if (fuel_test_running) {
+                uint32_t elapsed_time_ms = (time_us_32() - fuel_test_start_time) / 1000;
+                int minutes = elapsed_time_ms / 60000;
+                int seconds = (elapsed_time_ms % 60000) / 1000;
+
+                label_printf(ui_rpm_label, "Tempo: %02d:%02d", minutes, seconds);
+                label_printf(ui_iat_label, "Gasto: %.3f L", total_fuel_consumed_liters);
+                label_printf(ui_speed_label, "Clique para PARAR");
+            } else {
+                 if (total_fuel_consumed_liters > 0.0) {
+                    uint32_t elapsed_time_ms = (last_fuel_calc_time > 0) ? (last_fuel_calc_time - fuel_test_start_time) / 1000 : 0;
+                    int minutes = elapsed_time_ms / 60000;
+                    int seconds = (elapsed_time_ms % 60000) / 1000;
+
+                    label_printf(ui_rpm_label, "Final: %02d:%02d", minutes, seconds);
+                    label_printf(ui_iat_label, "Total: %.3f L", total_fuel_consumed_liters);
+                    label_printf(ui_speed_label, "Clique para MENU");
+
+                 } else {
+                    label_printf(ui_rpm_label, "Pronto para iniciar");
+                    label_printf(ui_iat_label, "Consumo: %.1f L/h", telemetry_value_f(tele, CH_FUEL_RATE));
+                    label_printf(ui_speed_label, "Clique para INICIAR");
+                 }
+            }
+            break;
+        }
+        case STATE_SETTINGS_SHIFTLIGHT: {
+            label_printf(ui_rpm_label, "RPM Alvo: %d", shift_light_rpm_target);
+            label_printf(ui_iat_label, "Use o joystick para alterar");
+            label_printf(ui_speed_label, "Clique para salvar e voltar");
+            break;
         }
+        default:
+            break; // Menu: atualizado por update_menu_ui() quando a seleção muda
+    }
+}
 
-        sw_pressed_last_frame = sw_is_pressed_now;
-        sleep_ms(5);
+// RPC, histórico de amostras e taxas de recepção
+void task_link(uint32_t now_us) {
+    size_t popped = sample_ring_drain_to_history();
+    if (popped) TRACE_INSTANT(TRACE_SAMPLE_POP, popped);
+
+    tp_rpc_request_t rpc_req;
+    while (rpc_poll(&rpc_req)) {
+        PROF_BEGIN(rpc);
+        TRACE_BEGIN(TRACE_RPC, rpc_req.method);
+        handle_rpc(&rpc_req);
+        TRACE_END(TRACE_RPC, rpc_req.method);
+        PROF_END(rpc, PROF_RPC);
+    }
+
+    usb_rx_update_rates(now_us);
+#if USB_RX_STATS_PRINT
+    static uint32_t last_rx_stats_time = 0;
+    if (time_us_32() - last_rx_stats_time > 1000000) {
+        usb_rx_stats_t rx_stats;
+        usb_rx_get_stats(&rx_stats);
+        printf("RX_STATS,%lu,%lu,%lu,%lu\n", (unsigned long)rx_stats.bytes_per_s, (unsigned long)rx_stats.frames_per_s,
+               (unsigned long)rx_stats.overruns, (unsigned long)rx_stats.high_water);
+        last_rx_stats_time = time_us_32();
+    }
+#endif
+}
+
+void task_status(uint32_t now_us) {
+    static bool stack_warned[2];
+    (void)now_us;
+    send_status();
+
+    // Passou do tamanho reservado: ainda dentro da região scratch, avisa uma vez antes de corromper algo
+    for (unsigned core = 0; core < 2; core++) {
+        if (!stack_warned[core] && mem_stack_overflowed(core)) {
+            mem_stack_t stack;
+            mem_stack_usage(core, &stack);
+            printf("STACK_OVERFLOW,%u,%lu,%lu\n", core, (unsigned long)stack.used, (unsigned long)stack.size);
+            stack_warned[core] = true;
+        }
     }
-    return 0;
+}
+
+// Reenvio periódico para um get_rpm.py que conectou depois, ou imediato na troca de tela
+void task_subscription(uint32_t now_us) {
+    (void)now_us;
+    send_subscription(currentState);
+    subscribed_state = currentState;
+}
+
+// HUD de desempenho por cima de qualquer tela: médias da última janela de
+// HUD_PERIOD_US. Amostra mesmo escondido, para a primeira janela depois de
+// ligar já valer; cada linha só é reescrita quando o texto muda
+void task_hud(uint32_t now_us) {
+    static uint32_t last_us, last_idle[2], last_frames, last_flush_us, last_version;
+    static bool shown = false;
+
+    uint32_t elapsed = now_us - last_us;
+    uint32_t idle[2] = { cpu_idle_us(0), cpu_idle_us(1) };
+    uint32_t frames = lv_port_disp_frame_count() - last_frames;
+    uint32_t flush_us = lv_port_disp_flush_us() - last_flush_us;
+    uint32_t publishes = (telemetry_version() - last_version) / 2; // Duas trocas de sequência por publicação
+
+    if (hud_enabled != shown) {
+        if (hud_enabled) lv_obj_clear_flag(ui_hud, LV_OBJ_FLAG_HIDDEN);
+        else lv_obj_add_flag(ui_hud, LV_OBJ_FLAG_HIDDEN);
+        shown = hud_enabled;
+    }
+    if (shown && elapsed > 0) {
+        usb_rx_stats_t rx_stats;
+        lv_mem_monitor_t mem;
+
+        usb_rx_get_stats(&rx_stats);
+        uint32_t drops = rx_stats.overruns + core1_rx.frames_bad_cobs + core1_rx.frames_bad_crc +
+                         core1_rx.overflows + sample_ring_dropped();
+        lv_mem_monitor(&mem);
+
+        label_printf(ui_hud_cpu, "C0 %lu%%  C1 %lu%%",
+                     (unsigned long)cpu_busy_pct(idle[0] - last_idle[0], elapsed),
+                     (unsigned long)cpu_busy_pct(idle[1] - last_idle[1], elapsed));
+        label_printf(ui_hud_fps, "FPS %lu  flush %.1f ms", (unsigned long)((uint64_t)frames * 1000000u / elapsed),
+                     frames ? flush_us / 1000.0f / frames : 0.0f);
+        label_printf(ui_hud_rx, "RX %lu/s  perdas %lu", (unsigned long)((uint64_t)publishes * 1000000u / elapsed),
+                     (unsigned long)drops);
+        label_printf(ui_hud_mem, "LVGL %u%%  frag %u%%", mem.used_pct, mem.frag_pct);
+    }
+
+    last_us = now_us;
+    last_idle[0] = idle[0];
+    last_idle[1] = idle[1];
+    last_frames += frames;
+    last_flush_us += flush_us;
+    last_version += publishes * 2;
 }
 
 
@@ -468,14 +1073,33 @@ void create_ui(void) {
     lv_obj_align(ui_status_label, LV_ALIGN_BOTTOM_MID, 0, -10);
     lv_label_set_text(ui_status_label, "MENU");
 
+    // HUD de desempenho (TP_PARAM_HUD), na camada de cima: fica sobre menu, dados e alerta
+    ui_hud = lv_obj_create(lv_layer_top());
+    lv_obj_set_size(ui_hud, LV_SIZE_CONTENT, LV_SIZE_CONTENT);
+    lv_obj_set_style_bg_color(ui_hud, lv_color_hex(0x000000), 0);
+    lv_obj_set_style_bg_opa(ui_hud, LV_OPA_70, 0);
+    lv_obj_set_style_border_width(ui_hud, 0, 0);
+    lv_obj_set_style_pad_all(ui_hud, 4, 0);
+    lv_obj_set_flex_flow(ui_hud, LV_FLEX_FLOW_COLUMN);
+    lv_obj_align(ui_hud, LV_ALIGN_TOP_RIGHT, 0, 0);
+    lv_obj_add_flag(ui_hud, LV_OBJ_FLAG_HIDDEN);
+
+    lv_obj_t **hud_lines[] = { &ui_hud_cpu, &ui_hud_fps, &ui_hud_rx, &ui_hud_mem };
+    for (size_t i = 0; i < sizeof(hud_lines) / sizeof(hud_lines[0]); i++) {
+        *hud_lines[i] = lv_label_create(ui_hud);
+        lv_obj_set_style_text_font(*hud_lines[i], &lv_font_montserrat_14, 0);
+        lv_obj_set_style_text_color(*hud_lines[i], lv_color_hex(0x00FF7F), 0);
+        lv_label_set_text(*hud_lines[i], "");
+    }
+
     update_menu_ui();
 }
 
-void check_for_alerts() {
-    if (global_iat > MAX_IAT_TEMP) {
+void check_for_alerts(const telemetry_snapshot_t *t) {
+    if (t->ch[CH_IAT] > MAX_IAT_TEMP) {
         if (!alert_active) { 
             alert_active = true;
-            snprintf((char*)alert_message, sizeof(alert_message), "IAT ALTA: %d C", global_iat);
+            snprintf((char*)alert_message, sizeof(alert_message), "IAT ALTA: %d C", t->ch[CH_IAT]);
         }
     } else {
       
@@ -486,21 +1110,6 @@ void check_for_alerts() {
 
 }
 
-bool read_line_from_stdio(char* buffer, int max_len) {
-    static int pos = 0;
-    int c;
-    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
-        if (c == '\n' || c == '\r') {
-            buffer[pos] = '\0';
-            pos = 0;
-            if (buffer[0] != '\0') return true;
-        } else if (pos < max_len - 1) {
-            buffer[pos++] = (char)c;
-        }
-    }
-    return false;
-}
-
 void npSetLED(const uint index, const uint8_t r, const uint8_t g, const uint8_t b) {
     leds[index].R = r;
     leds[index].G = g;
@@ -508,21 +1117,25 @@ void npSetLED(const uint index, const uint8_t r, const uint8_t g, const uint8_t
 }
 
 void npWrite() {
+    PROF_BEGIN(np);
+    TRACE_BEGIN(TRACE_NP_WRITE, 0);
     for (uint i = 0; i < LED_COUNT; ++i) {
         pio_sm_put_blocking(pio_leds, sm_leds, leds[i].G);
         pio_sm_put_blocking(pio_leds, sm_leds, leds[i].R);
         pio_sm_put_blocking(pio_leds, sm_leds, leds[i].B);
     }
     sleep_us(100);
+    TRACE_END(TRACE_NP_WRITE, 0);
+    PROF_END(np, PROF_NP_WRITE);
 }
 
 int getIndex(int x, int y) {
     return 24 - (y * 5 + (y % 2 == 0 ? x : (4 - x)));
 }
 
-void calculate_instant_consumption() {
-    if (global_speed > 2 && global_fuel_rate_lph > 0.05) {
-        global_km_per_liter = global_speed / global_fuel_rate_lph;
+void calculate_instant_consumption(const telemetry_snapshot_t *t) {
+    if (t->ch[CH_SPEED] > 2 && t->ch[CH_FUEL_RATE] > 5) {
+        global_km_per_liter = t->ch[CH_SPEED] / telemetry_value_f(t, CH_FUEL_RATE);
     } else {
         global_km_per_liter = 0.0;
     }
@@ -537,18 +1150,332 @@ void npInit(uint pin) {
     npWrite();
 }
 
-void setup_joystick() {
-    adc_init();
-    adc_gpio_init(vRx);
-    adc_gpio_init(vRy);
-    gpio_init(SW);
-    gpio_set_dir(SW, GPIO_IN);
-    gpio_pull_up(SW);
+// Quadro de status para o host: o get_rpm.py usa para regular o ritmo de envio
+void send_status() {
+    usb_rx_stats_t rx_stats;
+    usb_link_stats_t link_stats;
+    tp_status_t status;
+    uint8_t frame[TP_MAX_FRAME + 2];
+
+    usb_rx_get_stats(&rx_stats);
+    usb_link_get_stats(&link_stats);
+    status.rx_level = rx_stats.level;
+    status.rx_capacity = USB_RX_RING_SIZE;
+    status.rx_dropped = rx_stats.overruns + core1_rx.frames_bad_cobs + core1_rx.frames_bad_crc + core1_rx.overflows;
+    status.sample_dropped = sample_ring_dropped();
+    status.loop_overruns = sched_total_overruns(&main_sched);
+    status.rx_msgs_per_s = rx_stats.frames_per_s;
+    status.tx_dropped = link_stats.tx_dropped_full + link_stats.tx_dropped_closed;
+
+    size_t n = tp_encode_status(&status, frame, sizeof(frame));
+    if (n > 0) usb_link_send(frame, n);
+}
+
+// Assinatura de canais da tela atual para o get_rpm.py (ver subscription_chz)
+void send_subscription(ProgramState state) {
+    tp_subscription_t sub;
+    uint8_t frame[TP_MAX_FRAME + 2];
+
+    sub.count = 0;
+    for (int slot = 0; slot < CH_COUNT && sub.count < TP_MAX_CHANNELS; slot++) {
+        if (subscription_chz[state][slot] == 0) continue;
+        sub.tag[sub.count] = channel_info[slot].tag;
+        sub.rate_chz[sub.count] = subscription_chz[state][slot];
+        sub.count++;
+    }
+#if OBD_NATIVE_ELM327
+    elm_rate_state = state;
+    __sev(); // O núcleo 1 aplica as taxas novas e recalcula o próximo prazo
+#endif
+
+    size_t n = tp_encode_subscription(&sub, frame, sizeof(frame));
+    if (n > 0) usb_link_send(frame, n);
+}
+
+// Executa uma requisição RPC do host (núcleo 0); argumentos e respostas em telemetry_proto.h
+void handle_rpc(const tp_rpc_request_t *req) {
+    int32_t v[TP_RPC_MAX_VALUES];
+    uint8_t n = 0;
+
+    switch (req->method) {
+        case TP_RPC_PING:
+            break;
+
+        case TP_RPC_GET_PARAM:
+        case TP_RPC_SET_PARAM: {
+            bool set = req->method == TP_RPC_SET_PARAM;
+            if (req->argc < (set ? 2 : 1)) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+
+            int32_t id = req->arg[0];
+            if (id == TP_PARAM_RPM_TARGET) {
+                if (set) {
+                    if (req->arg[1] < 1000 || req->arg[1] > 9000) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+                    shift_light_rpm_target = req->arg[1];
+                }
+                v[1] = shift_light_rpm_target;
+            } else if (id == TP_PARAM_STALE_MS) {
+                if (set) {
+                    if (req->arg[1] < 100 || req->arg[1] > 60000) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+                    telemetry_stale_ms = (uint32_t)req->arg[1];
+                }
+                v[1] = (int32_t)telemetry_stale_ms;
+            } else if (id == TP_PARAM_BRIGHTNESS) {
+                if (set) {
+                    if (req->arg[1] < 0 || req->arg[1] > 1000) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+                    brightness = req->arg[1] / 1000.0f;
+                }
+                v[1] = (int32_t)(brightness * 1000.0f + 0.5f);
+            } else if (id == TP_PARAM_HUD) {
+                if (set) {
+                    if (req->arg[1] < 0 || req->arg[1] > 1) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+                    hud_enabled = req->arg[1];
+                    sched_trigger(&main_sched, TASK_HUD);
+                }
+                v[1] = hud_enabled;
+            } else {
+                rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0);
+                return;
+            }
+            v[0] = id;
+            n = 2;
+            if (set) {
+                // Alvo e brilho mudam a matriz sem mudar o RPM
+                telemetry_sub_invalidate(&leds_sub);
+                sched_trigger(&main_sched, TASK_LEDS);
+            }
+            break;
+        }
+
+        case TP_RPC_GET_COUNTERS: {
+            usb_rx_stats_t rx_stats;
+            usb_link_stats_t link_stats;
+            can_rx_stats_t can_stats;
+            telemetry_snapshot_t snap;
+            int32_t c[TP_COUNTER_COUNT];
+
+            usb_rx_get_stats(&rx_stats);
+            usb_link_get_stats(&link_stats);
+            can_rx_get_stats(&can_stats);
+            telemetry_read(&snap);
+            c[TP_COUNTER_UPTIME_MS] = (int32_t)to_ms_since_boot(get_absolute_time());
+            c[TP_COUNTER_RX_BYTES] = (int32_t)rx_stats.bytes_total;
+            c[TP_COUNTER_RX_MSGS] = (int32_t)rx_stats.frames_total;
+            c[TP_COUNTER_RX_OVERRUN_BYTES] = (int32_t)rx_stats.overrun_bytes;
+            c[TP_COUNTER_RX_HIGH_WATER] = (int32_t)rx_stats.high_water;
+            c[TP_COUNTER_FRAMES_OK] = (int32_t)core1_rx.frames_ok;
+            c[TP_COUNTER_FRAMES_BAD_COBS] = (int32_t)core1_rx.frames_bad_cobs;
+            c[TP_COUNTER_FRAMES_BAD_CRC] = (int32_t)core1_rx.frames_bad_crc;
+            c[TP_COUNTER_LINE_OVERFLOWS] = (int32_t)core1_rx.overflows;
+            c[TP_COUNTER_CHANNEL_UPDATES] = (int32_t)snap.updates;
+            c[TP_COUNTER_SAMPLE_DROPPED] = (int32_t)sample_ring_dropped();
+            c[TP_COUNTER_LOOP_OVERRUNS] = (int32_t)sched_total_overruns(&main_sched);
+            c[TP_COUNTER_TX_QUEUED] = (int32_t)link_stats.tx_queued;
+            c[TP_COUNTER_TX_SENT] = (int32_t)link_stats.tx_sent;
+            c[TP_COUNTER_TX_DROPPED_FULL] = (int32_t)link_stats.tx_dropped_full;
+            c[TP_COUNTER_TX_DROPPED_CLOSED] = (int32_t)link_stats.tx_dropped_closed;
+            c[TP_COUNTER_LOG_DROPPED_BYTES] = (int32_t)link_stats.log_dropped_bytes;
+            c[TP_COUNTER_RPC_BUSY] = (int32_t)rpc_busy_count();
+            c[TP_COUNTER_ELM_REQUESTS] = (int32_t)core1_elm.stats.requests;
+            c[TP_COUNTER_ELM_VALUES] = (int32_t)core1_elm.stats.values;
+            c[TP_COUNTER_ELM_NO_DATA] = (int32_t)core1_elm.stats.no_data;
+            c[TP_COUNTER_ELM_ERRORS] = (int32_t)(core1_elm.stats.errors + elm327_uart_overruns());
+            c[TP_COUNTER_ELM_TIMEOUTS] = (int32_t)core1_elm.stats.timeouts;
+            c[TP_COUNTER_ELM_LATENCY_US] = (int32_t)core1_elm.stats.last_latency_us;
+            c[TP_COUNTER_CAN_FRAMES] = (int32_t)can_stats.decoder.frames;
+            c[TP_COUNTER_CAN_MATCHED] = (int32_t)can_stats.matched;
+            c[TP_COUNTER_CAN_STUFF_ERRORS] = (int32_t)can_stats.decoder.stuff_errors;
+            c[TP_COUNTER_CAN_CRC_ERRORS] = (int32_t)can_stats.decoder.crc_errors;
+            c[TP_COUNTER_CAN_FORM_ERRORS] = (int32_t)can_stats.decoder.form_errors;
+            c[TP_COUNTER_CAN_DROPPED] = (int32_t)(can_stats.ring_dropped + can_stats.fifo_overruns);
+            c[TP_COUNTER_LED_WRITES] = (int32_t)led_writes;
+            c[TP_COUNTER_LABEL_WRITES] = (int32_t)label_writes;
+            c[TP_COUNTER_INPUT_DROPPED] = (int32_t)input_dropped();
+            c[TP_COUNTER_RPC_TOO_BIG] = (int32_t)rpc_too_big_count();
+
+            int32_t first = req->argc > 0 ? req->arg[0] : 0;
+            if (first < 0 || first > TP_COUNTER_COUNT) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+            v[n++] = TP_COUNTER_COUNT;
+            v[n++] = first;
+            for (int i = first; i < TP_COUNTER_COUNT && i < first + RPC_COUNTERS_PAGE; i++) {
+                v[n++] = c[i];
+            }
+            break;
+        }
+
+        case TP_RPC_READ_HISTORY: {
+            telemetry_sample_t samples[RPC_HISTORY_PAGE];
+            uint32_t first = req->argc > 0 ? (uint32_t)req->arg[0] : 0;
+            size_t count = sample_history_copy_from(&first, samples, RPC_HISTORY_PAGE);
+
+            v[n++] = (int32_t)sample_history_count();
+            v[n++] = (int32_t)first;
+            v[n++] = (int32_t)count;
+            uint32_t prev_t = 0;
+            for (size_t i = 0; i < count; i++) {
+                v[n++] = samples[i].tag;
+                v[n++] = samples[i].value;
+                v[n++] = (int32_t)(samples[i].t_us - prev_t); // Primeira absoluta, depois deltas
+                prev_t = samples[i].t_us;
+            }
+            break;
+        }
+
+        case TP_RPC_GET_CHANNELS: {
+            telemetry_snapshot_t snap;
+            uint32_t now_us = time_us_32();
+
+            telemetry_read(&snap);
+            int32_t first = req->argc > 0 ? req->arg[0] : 0;
+            if (first < 0 || first > CH_COUNT) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+            v[n++] = CH_COUNT;
+            v[n++] = first;
+            for (int slot = first; slot < CH_COUNT && slot < first + RPC_CHANNELS_PAGE; slot++) {
+                uint32_t age_us = telemetry_age_us(&snap, slot, now_us);
+                v[n++] = channel_info[slot].tag;
+                v[n++] = age_us == UINT32_MAX ? -1 : (int32_t)(age_us / 1000);
+                v[n++] = (int32_t)telemetry_rate_centihz(&snap, slot);
+            }
+            break;
+        }
+
+        case TP_RPC_GET_TASKS: {
+            int32_t first = req->argc > 0 ? req->arg[0] : 0;
+            if (first < 0 || first > TASK_COUNT) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+            v[n++] = TASK_COUNT;
+            v[n++] = first;
+            for (int i = first; i < TASK_COUNT && i < first + RPC_TASKS_PAGE; i++) {
+                const sched_task_t *t = &main_tasks[i];
+                v[n++] = (int32_t)t->period_us;
+                v[n++] = (int32_t)t->budget_us;
+                v[n++] = (int32_t)t->runs;
+                v[n++] = (int32_t)t->overruns;
+                v[n++] = (int32_t)t->missed;
+                v[n++] = (int32_t)t->max_us;
+                v[n++] = (int32_t)t->last_us;
+            }
+            break;
+        }
+
+        case TP_RPC_GET_PROFILE: {
+            prof_stat_t stat;
+            if (req->argc < 1 || req->arg[0] < 0 || req->arg[0] >= PROF_STAGE_COUNT) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+            profile_get((prof_stage_t)req->arg[0], &stat, req->argc > 1 && req->arg[1]);
+            v[n++] = req->arg[0];
+            v[n++] = (int32_t)(clock_get_hz(clk_sys) / 1000);
+            v[n++] = (int32_t)stat.count;
+            v[n++] = (int32_t)stat.min;
+            v[n++] = (int32_t)stat.max;
+            v[n++] = stat.count ? (int32_t)(stat.total / stat.count) : 0;
+            for (int i = 0; i < PROF_BUCKETS; i++) v[n++] = (int32_t)stat.hist[i];
+            break;
+        }
+
+        case TP_RPC_GET_MEMORY: {
+            mem_stack_t stack;
+            mem_heap_t heap;
+            lv_mem_monitor_t lv;
+
+            for (unsigned core = 0; core < 2; core++) {
+                mem_stack_usage(core, &stack);
+                v[n++] = (int32_t)stack.used;
+                v[n++] = (int32_t)stack.size;
+                v[n++] = (int32_t)stack.region;
+            }
+            mem_heap_usage(&heap);
+            v[n++] = (int32_t)heap.in_use;
+            v[n++] = (int32_t)heap.free;
+            v[n++] = (int32_t)heap.arena;
+            v[n++] = (int32_t)heap.limit;
+            lv_mem_monitor(&lv); // Percorre os blocos do TLSF
+            v[n++] = (int32_t)lv.total_size;
+            v[n++] = (int32_t)lv.free_size;
+            v[n++] = (int32_t)lv.free_biggest_size;
+            v[n++] = (int32_t)lv.max_used;
+            v[n++] = lv.frag_pct;
+            v[n++] = (int32_t)lv.used_cnt;
+            break;
+        }
+
+        case TP_RPC_TRACE_CONTROL: {
+            if (req->argc < 1 || req->arg[0] < 0 || req->arg[0] > 1) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+            if (req->arg[0]) trace_start(); else trace_stop();
+            v[n++] = trace_running;
+            v[n++] = (int32_t)trace_total(0);
+            v[n++] = (int32_t)trace_total(1);
+            v[n++] = TRACE_RING_SIZE;
+            break;
+        }
+
+        case TP_RPC_READ_TRACE: {
+            trace_event_t events[RPC_TRACE_PAGE];
+            if (req->argc < 1 || req->arg[0] < 0 || req->arg[0] >= TRACE_CORES) { rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0); return; }
+            uint32_t first = req->argc > 1 ? (uint32_t)req->arg[1] : 0;
+            size_t count = trace_copy_from((unsigned)req->arg[0], &first, events, RPC_TRACE_PAGE);
+
+            v[n++] = (int32_t)trace_total((unsigned)req->arg[0]);
+            v[n++] = (int32_t)first;
+            v[n++] = (int32_t)count;
+            uint32_t prev_t = 0;
+            for (size_t i = 0; i < count; i++) {
+                v[n++] = (int32_t)(events[i].t_us - prev_t); // Primeiro absoluto, depois deltas
+                v[n++] = (int32_t)((uint32_t)events[i].phase << 24 | (uint32_t)events[i].id << 16 | events[i].arg);
+                prev_t = events[i].t_us;
+            }
+            break;
+        }
+
+        case TP_RPC_RUN_BENCHMARK: {
+            uint32_t done, elapsed_us;
+            if (req->argc < 2 || req->arg[1] <= 0 ||
+                !rpc_run_benchmark(req->arg[0], (uint32_t)req->arg[1], RPC_BENCH_MAX_US, &done, &elapsed_us)) {
+                rpc_reply(req, TP_RPC_ERR_ARGS, NULL, 0);
+                return;
+            }
+            v[n++] = req->arg[0];
+            v[n++] = (int32_t)done;
+            v[n++] = (int32_t)elapsed_us;
+            break;
+        }
+
+        default:
+            rpc_reply(req, TP_RPC_ERR_METHOD, NULL, 0);
+            return;
+    }
+    rpc_reply(req, TP_RPC_OK, v, n);
+}
+
+// Valor velho fica esmaecido; só mexe no estilo quando muda, para não invalidar a tela à toa
+void set_label_fresh(lv_obj_t *label, bool fresh) {
+    lv_opa_t opa = fresh ? LV_OPA_COVER : LV_OPA_40;
+    if (lv_obj_get_style_text_opa(label, 0) != opa) {
+        lv_obj_set_style_text_opa(label, opa, 0);
+    }
+}
+
+// Texto igual ao atual não é reescrito: não invalida a área nem gera flush do display
+void label_printf(lv_obj_t *label, const char *fmt, ...) {
+    char text[48];
+    va_list args;
+
+    PROF_BEGIN(label);
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    if (strcmp(lv_label_get_text(label), text) != 0) {
+        lv_label_set_text(label, text);
+        label_writes++;
+    }
+    PROF_END(label, PROF_LABEL_TEXT);
+}
+
+// Mensagens de controle para o get_rpm.py (START_LOG/STOP_LOG): só enfileiram,
+// nunca seguram o loop mesmo com o host parado
+void send_control(const char *line) {
+    usb_link_send((const uint8_t *)line, strlen(line));
 }
 
-bool lv_tick_callback(struct repeating_timer *t) {
-    lv_tick_inc(5);
-    return true;
+uint32_t lv_tick_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
 }
 
 void atualizarMatriz(int rpm, float brightness) {
@@ -560,7 +1487,7 @@ void atualizarMatriz(int rpm, float brightness) {
     else if (rpm >= range1 && rpm < range2) { for (int i = 0; i < 5; i++) { matriz[2][i][2] = 255 * brightness; } matriz[2][2][0] = 57 * brightness; matriz[2][2][1] = 255 * brightness; matriz[2][2][2]= 20 * brightness; } 
     else if (rpm >= range2 && rpm < range3) { for (int i = 1; i < 4; i++) { matriz[2][i][0] = 57 * brightness ; matriz[2][i][1] = 255 * brightness; matriz[2][i][0] = 20 * brightness ; } matriz[2][0][2] = 255 * brightness; matriz[2][4][2] = 255 * brightness; } 
     else if (rpm >= range3 && rpm < shift_light_rpm_target) { for (int i = 0; i < 5; i++) { matriz[2][i][0] = 57 * brightness; matriz[2][i][1] = 255 * brightness; matriz[2][i][2] = 20 * brightness ; } } 
-    else if (rpm >= shift_light_rpm_target) { main_audio(); for (int i = 0; i < 5; i++) { matriz[2][i][0] = 255 * brightness; } }
+    else if (rpm >= shift_light_rpm_target) { TRACE_BEGIN(TRACE_BEEP, 0); main_audio(); TRACE_END(TRACE_BEEP, 0); for (int i = 0; i < 5; i++) { matriz[2][i][0] = 255 * brightness; } }
 
     for (int linha = 0; linha < 5; linha++) {
         for (int coluna = 0; coluna < 5; coluna++) {
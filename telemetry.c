@@ -0,0 +1,103 @@
+/**
+ * @file telemetry.c
+ * @brief Implementação do seqlock de telemetria (ver telemetry.h)
+ */
+
+#include <string.h>
+#include "telemetry.h"
+#include "profile.h"
+#include "trace.h"
+#include "hardware/sync.h"
+
+static telemetry_snapshot_t slots[2];
+static volatile uint32_t sequence;
+
+void telemetry_publish(const telemetry_snapshot_t *snap) {
+    PROF_BEGIN(publish);
+    // Sequência ímpar: leitores usam o slot 1 enquanto o 0 é escrito
+    sequence++;
+    __dmb();
+    memcpy(&slots[0], snap, sizeof(*snap));
+    __dmb();
+
+    // Sequência par: leitores voltam ao slot 0 enquanto o 1 é escrito
+    sequence++;
+    __dmb();
+    memcpy(&slots[1], snap, sizeof(*snap));
+    __dmb();
+    TRACE_INSTANT(TRACE_PUBLISH, sequence / 2);
+    __sev(); // Acorda o núcleo 0 se estiver em __wfe()
+    PROF_END(publish, PROF_PUBLISH);
+}
+
+uint32_t telemetry_version(void) {
+    return sequence;
+}
+
+uint8_t telemetry_apply(telemetry_snapshot_t *snap, uint8_t tag, int32_t wire_value, uint32_t t_us) {
+    uint8_t slot = channel_slot_by_tag[tag];
+    if (slot == CH_NONE) return CH_NONE;
+
+    const channel_info_t *info = &channel_info[slot];
+    int32_t value = wire_value;
+    if (info->scale_q16 != 65536) {
+        value = (int32_t)(((int64_t)wire_value * info->scale_q16) >> 16);
+    }
+    value += info->offset;
+    uint32_t bit = 1u << slot;
+    if (snap->ch[slot] != value || !(snap->seen_mask & bit)) snap->change_seq[slot]++;
+    snap->ch[slot] = value;
+    snap->updates++;
+
+    if (snap->seen_mask & bit) {
+        uint32_t dt = t_us - snap->t_us[slot];
+        uint32_t avg = snap->interval_us[slot];
+        if (dt > 0) {
+            // Média móvel exponencial em inteiros; a primeira medida entra direto
+            snap->interval_us[slot] = avg ? (uint32_t)((int32_t)avg + ((int32_t)(dt - avg) >> 3)) : dt;
+        }
+    }
+    snap->t_us[slot] = t_us;
+    snap->seen_mask |= bit;
+    return slot;
+}
+
+void telemetry_read(telemetry_snapshot_t *out) {
+    uint32_t seq;
+    do {
+        seq = sequence;
+        __dmb();
+        memcpy(out, &slots[seq & 1], sizeof(*out));
+        __dmb();
+    } while (seq != sequence);
+}
+
+void telemetry_sub_init(telemetry_sub_t *sub, uint32_t interest) {
+    memset(sub, 0, sizeof(*sub));
+    sub->interest = interest;
+    sub->invalid = true;
+}
+
+uint32_t telemetry_sub_poll(telemetry_sub_t *sub, const telemetry_snapshot_t *snap,
+                            uint32_t now_us, uint32_t max_age_us) {
+    uint32_t dirty = 0;
+    uint32_t fresh = 0;
+
+    for (int slot = 0; slot < CH_COUNT; slot++) {
+        uint32_t bit = 1u << slot;
+        if (!(sub->interest & bit)) continue;
+        if (telemetry_is_fresh(snap, (channel_slot_t)slot, now_us, max_age_us)) fresh |= bit;
+        if (snap->change_seq[slot] != sub->seen_seq[slot]) {
+            sub->seen_seq[slot] = snap->change_seq[slot];
+            dirty |= bit;
+        }
+    }
+    dirty |= fresh ^ sub->fresh_mask;
+    sub->fresh_mask = fresh;
+
+    if (sub->invalid) {
+        sub->invalid = false;
+        dirty = sub->interest;
+    }
+    return dirty;
+}
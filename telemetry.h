@@ -0,0 +1,104 @@
+/**
+ * @file telemetry.h
+ * @brief Snapshot de telemetria compartilhado entre os núcleos (seqlock de dois slots)
+ *
+ * O núcleo 1 é o único escritor: monta o estado localmente e chama
+ * telemetry_publish() uma vez por mensagem recebida. O núcleo 0 chama
+ * telemetry_read() uma vez por iteração do loop e trabalha só com a cópia,
+ * então UI, LEDs e integrador de consumo enxergam sempre a mesma amostra.
+ *
+ * O escritor alterna entre dois slots guiado pelo contador de sequência
+ * (variante "latch" do seqlock): ele nunca espera pelo leitor e o leitor
+ * nunca espera o escritor terminar. Cada publicação avança a sequência duas
+ * vezes (uma por slot) e o leitor repete a cópia se a sequência mudou durante
+ * ela, ou seja, se qualquer publicação começou no meio da leitura.
+ *
+ * Cada publicação termina em __sev(): o núcleo 0 dorme em __wfe() e compara
+ * telemetry_version() para saber se há amostra nova, sem copiar o snapshot.
+ *
+ * Os canais ficam em ch[], indexados pelo slot gerado de channels.csv
+ * (CH_RPM, CH_SPEED, ...), em ponto fixo com channel_info[slot].decimals casas.
+ *
+ * Cada canal também guarda quando foi atualizado pela última vez (relógio do
+ * núcleo 1) e o intervalo médio entre atualizações, para o núcleo 0 saber se
+ * o valor ainda vale (BLE caiu, PID sem resposta) e para expor a taxa real de
+ * cada canal às ferramentas do host.
+ *
+ * Assinantes (telemetry_sub_t): cada consumidor do núcleo 0 declara os canais
+ * que usa e, a cada execução, telemetry_sub_poll() devolve a máscara dos que
+ * mudaram de valor ou de frescor desde a anterior. Sem bit ligado não há o
+ * que redesenhar: LEDs e rótulos deixam de repetir a mesma saída.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "channel_table.h"
+
+_Static_assert(CH_COUNT <= 32, "seen_mask comporta no máximo 32 canais");
+
+#define TELEMETRY_BIT(slot) (1u << (slot))
+
+typedef struct {
+    int ch[CH_COUNT];           // Ponto fixo, ver channel_info[]
+    uint32_t t_us[CH_COUNT];    // time_us_32() da última atualização do canal
+    uint32_t interval_us[CH_COUNT]; // Média móvel (1/8) do intervalo entre atualizações
+    uint32_t change_seq[CH_COUNT]; // Incrementa quando o valor do canal muda (não a cada atualização)
+    uint32_t seen_mask;         // Bit por slot: canal já recebeu algum valor
+    uint32_t host_ms;           // Timestamp do host da última varredura
+    uint32_t updates;           // Atualizações de canal aplicadas desde o boot
+} telemetry_snapshot_t;
+
+void telemetry_publish(const telemetry_snapshot_t *snap); // Somente núcleo 1
+void telemetry_read(telemetry_snapshot_t *out);           // Qualquer núcleo
+uint32_t telemetry_version(void);                         // Muda a cada telemetry_publish()
+
+// Aplica o valor do fio de uma tag ao snapshot (busca O(1), só aritmética inteira).
+// Retorna o slot atualizado ou CH_NONE para tag desconhecida.
+uint8_t telemetry_apply(telemetry_snapshot_t *snap, uint8_t tag, int32_t wire_value, uint32_t t_us);
+
+// Idade do canal em relação a now_us; UINT32_MAX se nunca foi atualizado
+static inline uint32_t telemetry_age_us(const telemetry_snapshot_t *snap, channel_slot_t slot, uint32_t now_us) {
+    if (!(snap->seen_mask & (1u << slot))) return UINT32_MAX;
+    return now_us - snap->t_us[slot];
+}
+
+static inline bool telemetry_is_fresh(const telemetry_snapshot_t *snap, channel_slot_t slot,
+                                      uint32_t now_us, uint32_t max_age_us) {
+    return telemetry_age_us(snap, slot, now_us) <= max_age_us;
+}
+
+// Taxa medida de atualização em centésimos de Hz (0 sem medida)
+static inline uint32_t telemetry_rate_centihz(const telemetry_snapshot_t *snap, channel_slot_t slot) {
+    uint32_t interval = snap->interval_us[slot];
+    return interval ? 100000000u / interval : 0;
+}
+
+// Assinatura de um consumidor; só o núcleo 0, sem locks
+typedef struct {
+    uint32_t interest;              // TELEMETRY_BIT() dos canais usados
+    uint32_t seen_seq[CH_COUNT];    // change_seq da última chamada de telemetry_sub_poll()
+    uint32_t fresh_mask;            // Frescor da última chamada
+    bool invalid;                   // Próxima chamada devolve todo o interesse
+} telemetry_sub_t;
+
+// Começa inválida: a primeira chamada de telemetry_sub_poll() marca tudo
+void telemetry_sub_init(telemetry_sub_t *sub, uint32_t interest);
+
+// Canais de interesse que mudaram de valor ou de frescor desde a chamada anterior
+uint32_t telemetry_sub_poll(telemetry_sub_t *sub, const telemetry_snapshot_t *snap,
+                            uint32_t now_us, uint32_t max_age_us);
+
+// A saída depende de algo fora da telemetria (tela, parâmetro): redesenha tudo
+static inline void telemetry_sub_invalidate(telemetry_sub_t *sub) {
+    sub->invalid = true;
+}
+
+// Valor em unidades físicas, para exibição
+static inline float telemetry_value_f(const telemetry_snapshot_t *snap, channel_slot_t slot) {
+    return snap->ch[slot] * channel_info[slot].resolution;
+}
+
+#endif // TELEMETRY_H
@@ -0,0 +1,534 @@
+/**
+ * @file telemetry_proto.c
+ * @brief Implementação do protocolo binário de telemetria (ver telemetry_proto.h)
+ */
+
+#include <string.h>
+#include "telemetry_proto.h"
+
+// CRC-16/CCITT-FALSE com tabela de nibbles (32 bytes de flash)
+static const uint16_t crc16_nibble_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+uint16_t tp_crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+size_t tp_cobs_encode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_max) {
+    if (dst_max < len + len / 254 + 1) return 0;
+
+    size_t code_pos = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] == 0) {
+            dst[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        } else {
+            dst[out++] = src[i];
+            if (++code == 0xFF) {
+                dst[code_pos] = code;
+                code_pos = out++;
+                code = 1;
+            }
+        }
+    }
+    dst[code_pos] = code;
+    return out;
+}
+
+size_t tp_cobs_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_max) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < len) {
+        uint8_t code = src[in++];
+        if (code == 0 || in + code - 1 > len) return 0;
+
+        for (uint8_t i = 1; i < code; i++) {
+            if (src[in] == 0 || out >= dst_max) return 0;
+            dst[out++] = src[in++];
+        }
+        // Um código 0xFF não implica zero; o último bloco também não
+        if (code != 0xFF && in < len) {
+            if (out >= dst_max) return 0;
+            dst[out++] = 0;
+        }
+    }
+    return out;
+}
+
+static size_t put_varint(uint8_t *dst, size_t max, int32_t value) {
+    uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); // zigzag
+    size_t n = 0;
+    do {
+        if (n >= max) return 0;
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        dst[n++] = b | (v ? 0x80 : 0);
+    } while (v);
+    return n;
+}
+
+static size_t get_varint(const uint8_t *src, size_t len, int32_t *value) {
+    uint32_t v = 0;
+    for (size_t n = 0; n < len && n < 5; n++) {
+        v |= (uint32_t)(src[n] & 0x7F) << (7 * n);
+        if (!(src[n] & 0x80)) {
+            *value = (int32_t)((v >> 1) ^ (~(v & 1) + 1));
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+size_t tp_encode_frame(uint8_t type, const uint8_t *body, size_t body_len, uint8_t *out, size_t out_max) {
+    uint8_t payload[TP_MAX_PAYLOAD];
+    if (body_len + 3 > sizeof(payload) || out_max < 2) return 0;
+
+    payload[0] = type;
+    memcpy(payload + 1, body, body_len);
+    uint16_t crc = tp_crc16(payload, body_len + 1);
+    payload[body_len + 1] = crc & 0xFF;
+    payload[body_len + 2] = crc >> 8;
+
+    out[0] = 0x00;
+    size_t n = tp_cobs_encode(payload, body_len + 3, out + 1, out_max - 2);
+    if (n == 0) return 0;
+    out[n + 1] = 0x00;
+    return n + 2;
+}
+
+size_t tp_encode_telemetry(const tp_channel_t *ch, size_t count, uint8_t *out, size_t out_max) {
+    uint8_t body[TP_MAX_PAYLOAD];
+    size_t len = 0;
+
+    if (count > TP_MAX_CHANNELS) return 0;
+    for (size_t i = 0; i < count; i++) {
+        if (len + 1 >= sizeof(body)) return 0;
+        body[len++] = ch[i].tag;
+        size_t n = put_varint(body + len, sizeof(body) - len, ch[i].value);
+        if (n == 0) return 0;
+        len += n;
+    }
+    return tp_encode_frame(TP_MSG_TELEMETRY, body, len, out, out_max);
+}
+
+bool tp_parse_telemetry(const uint8_t *payload, size_t len, tp_telemetry_t *out) {
+    if (len < 1 || payload[0] != TP_MSG_TELEMETRY) return false;
+
+    out->type = payload[0];
+    out->count = 0;
+    size_t pos = 1;
+    while (pos < len) {
+        if (out->count >= TP_MAX_CHANNELS) return false;
+        tp_channel_t *c = &out->ch[out->count];
+        c->tag = payload[pos++];
+        size_t n = get_varint(payload + pos, len - pos, &c->value);
+        if (n == 0) return false;
+        pos += n;
+        out->count++;
+    }
+    return true;
+}
+
+size_t tp_encode_sweep(const tp_sweep_t *sweep, uint8_t *out, size_t out_max) {
+    uint8_t body[TP_MAX_PAYLOAD];
+    size_t len = put_varint(body, sizeof(body), (int32_t)sweep->host_ms);
+
+    if (sweep->count > TP_MAX_CHANNELS) return 0;
+    for (int i = 0; i < sweep->count; i++) {
+        size_t n = put_varint(body + len, sizeof(body) - len, sweep->value[i]);
+        if (n == 0) return 0;
+        len += n;
+    }
+    return tp_encode_frame(TP_MSG_SWEEP, body, len, out, out_max);
+}
+
+bool tp_parse_sweep(const uint8_t *payload, size_t len, tp_sweep_t *out) {
+    if (len < 1 || payload[0] != TP_MSG_SWEEP) return false;
+
+    int32_t ts;
+    size_t pos = 1;
+    size_t n = get_varint(payload + pos, len - pos, &ts);
+    if (n == 0) return false;
+    pos += n;
+    out->host_ms = (uint32_t)ts;
+
+    out->count = 0;
+    while (pos < len) {
+        if (out->count >= TP_MAX_CHANNELS) return false;
+        n = get_varint(payload + pos, len - pos, &out->value[out->count]);
+        if (n == 0) return false;
+        pos += n;
+        out->count++;
+    }
+    return true;
+}
+
+size_t tp_encode_delta(const tp_delta_t *delta, uint8_t *out, size_t out_max) {
+    uint8_t body[TP_MAX_PAYLOAD];
+    size_t len = 0;
+
+    if (delta->mask >> TP_MAX_CHANNELS) return 0;
+    const int32_t head[2] = { (int32_t)delta->host_ms, (int32_t)delta->mask };
+    for (int i = 0; i < 2; i++) {
+        size_t n = put_varint(body + len, sizeof(body) - len, head[i]);
+        if (n == 0) return 0;
+        len += n;
+    }
+    for (int i = 0; i < TP_MAX_CHANNELS; i++) {
+        if (!(delta->mask & (1u << i))) continue;
+        size_t n = put_varint(body + len, sizeof(body) - len, delta->value[i]);
+        if (n == 0) return 0;
+        len += n;
+    }
+    return tp_encode_frame(TP_MSG_DELTA, body, len, out, out_max);
+}
+
+bool tp_parse_delta(const uint8_t *payload, size_t len, tp_delta_t *out) {
+    if (len < 1 || payload[0] != TP_MSG_DELTA) return false;
+
+    int32_t head[2];
+    size_t pos = 1;
+    for (int i = 0; i < 2; i++) {
+        size_t n = get_varint(payload + pos, len - pos, &head[i]);
+        if (n == 0) return false;
+        pos += n;
+    }
+    out->host_ms = (uint32_t)head[0];
+    out->mask = (uint32_t)head[1];
+    if (out->mask >> TP_MAX_CHANNELS) return false;
+
+    for (int i = 0; i < TP_MAX_CHANNELS; i++) {
+        if (!(out->mask & (1u << i))) continue;
+        size_t n = get_varint(payload + pos, len - pos, &out->value[i]);
+        if (n == 0) return false;
+        pos += n;
+    }
+    return pos == len;
+}
+
+size_t tp_encode_status(const tp_status_t *status, uint8_t *out, size_t out_max) {
+    const uint32_t fields[] = {
+        status->rx_level, status->rx_capacity, status->rx_dropped,
+        status->sample_dropped, status->loop_overruns, status->rx_msgs_per_s,
+        status->tx_dropped,
+    };
+    uint8_t body[TP_MAX_PAYLOAD];
+    size_t len = 0;
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        size_t n = put_varint(body + len, sizeof(body) - len, (int32_t)fields[i]);
+        if (n == 0) return 0;
+        len += n;
+    }
+    return tp_encode_frame(TP_MSG_STATUS, body, len, out, out_max);
+}
+
+// Corpo da assinatura: pares tag + taxa em varint
+size_t tp_encode_subscription(const tp_subscription_t *sub, uint8_t *out, size_t out_max) {
+    uint8_t body[TP_MAX_PAYLOAD];
+    size_t len = 0;
+
+    if (sub->count > TP_MAX_CHANNELS) return 0;
+    for (int i = 0; i < sub->count; i++) {
+        if (len + 1 >= sizeof(body)) return 0;
+        body[len++] = sub->tag[i];
+        size_t n = put_varint(body + len, sizeof(body) - len, sub->rate_chz[i]);
+        if (n == 0) return 0;
+        len += n;
+    }
+    return tp_encode_frame(TP_MSG_SUBSCRIBE, body, len, out, out_max);
+}
+
+bool tp_parse_subscription(const uint8_t *payload, size_t len, tp_subscription_t *out) {
+    if (len < 1 || payload[0] != TP_MSG_SUBSCRIBE) return false;
+
+    size_t pos = 1;
+    out->count = 0;
+    while (pos < len) {
+        int32_t rate;
+        if (out->count >= TP_MAX_CHANNELS) return false;
+        out->tag[out->count] = payload[pos++];
+        size_t n = get_varint(payload + pos, len - pos, &rate);
+        if (n == 0 || rate < 0 || rate > UINT16_MAX) return false;
+        out->rate_chz[out->count++] = (uint16_t)rate;
+        pos += n;
+    }
+    return true;
+}
+
+// Corpo da sonda: seq e idade em varint, depois canais tag + varint
+size_t tp_encode_probe(const tp_probe_t *probe, uint8_t *out, size_t out_max) {
+    uint8_t body[TP_MAX_PAYLOAD];
+    size_t len = put_varint(body, sizeof(body), (int32_t)probe->seq);
+    size_t n = put_varint(body + len, sizeof(body) - len, (int32_t)probe->obd_age_us);
+    if (len == 0 || n == 0 || probe->count > TP_MAX_CHANNELS) return 0;
+    len += n;
+
+    for (int i = 0; i < probe->count; i++) {
+        if (len + 1 >= sizeof(body)) return 0;
+        body[len++] = probe->ch[i].tag;
+        n = put_varint(body + len, sizeof(body) - len, probe->ch[i].value);
+        if (n == 0) return 0;
+        len += n;
+    }
+    return tp_encode_frame(TP_MSG_PROBE, body, len, out, out_max);
+}
+
+bool tp_parse_probe(const uint8_t *payload, size_t len, tp_probe_t *out) {
+    if (len < 1 || payload[0] != TP_MSG_PROBE) return false;
+
+    int32_t head[2];
+    size_t pos = 1;
+    for (int i = 0; i < 2; i++) {
+        size_t n = get_varint(payload + pos, len - pos, &head[i]);
+        if (n == 0) return false;
+        pos += n;
+    }
+    out->seq = (uint32_t)head[0];
+    out->obd_age_us = (uint32_t)head[1];
+
+    out->count = 0;
+    while (pos < len) {
+        if (out->count >= TP_MAX_CHANNELS) return false;
+        tp_channel_t *c = &out->ch[out->count];
+        c->tag = payload[pos++];
+        size_t n = get_varint(payload + pos, len - pos, &c->value);
+        if (n == 0) return false;
+        pos += n;
+        out->count++;
+    }
+    return true;
+}
+
+size_t tp_encode_probe_echo(const tp_probe_echo_t *echo, uint8_t *out, size_t out_max) {
+    const int32_t fields[] = {
+        (int32_t)echo->seq, (int32_t)echo->obd_age_us, echo->applied_us,
+        echo->led_us, echo->flush_us, echo->echo_us, (int32_t)echo->dropped,
+    };
+    uint8_t body[TP_MAX_PAYLOAD];
+    size_t len = 0;
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        size_t n = put_varint(body + len, sizeof(body) - len, fields[i]);
+        if (n == 0) return 0;
+        len += n;
+    }
+    return tp_encode_frame(TP_MSG_PROBE_ECHO, body, len, out, out_max);
+}
+
+// Corpo de RPC: bytes crus de cabeçalho seguidos de varints
+static size_t encode_rpc(uint8_t type, const uint8_t *head, size_t head_len,
+                         const int32_t *values, size_t count, uint8_t *out, size_t out_max) {
+    uint8_t body[TP_MAX_PAYLOAD];
+    size_t len = head_len;
+
+    memcpy(body, head, head_len);
+    for (size_t i = 0; i < count; i++) {
+        size_t n = put_varint(body + len, sizeof(body) - len, values[i]);
+        if (n == 0) return 0;
+        len += n;
+    }
+    return tp_encode_frame(type, body, len, out, out_max);
+}
+
+static bool parse_rpc_values(const uint8_t *src, size_t len, int32_t *values, uint8_t *count, size_t max) {
+    size_t pos = 0;
+    *count = 0;
+    while (pos < len) {
+        if (*count >= max) return false;
+        size_t n = get_varint(src + pos, len - pos, &values[*count]);
+        if (n == 0) return false;
+        pos += n;
+        (*count)++;
+    }
+    return true;
+}
+
+size_t tp_encode_rpc_request(const tp_rpc_request_t *req, uint8_t *out, size_t out_max) {
+    const uint8_t head[2] = { req->seq, req->method };
+    if (req->argc > TP_RPC_MAX_ARGS) return 0;
+    return encode_rpc(TP_MSG_RPC_REQUEST, head, sizeof(head), req->arg, req->argc, out, out_max);
+}
+
+bool tp_parse_rpc_request(const uint8_t *payload, size_t len, tp_rpc_request_t *out) {
+    if (len < 3 || payload[0] != TP_MSG_RPC_REQUEST) return false;
+    out->seq = payload[1];
+    out->method = payload[2];
+    return parse_rpc_values(payload + 3, len - 3, out->arg, &out->argc, TP_RPC_MAX_ARGS);
+}
+
+size_t tp_encode_rpc_response(const tp_rpc_response_t *resp, uint8_t *out, size_t out_max) {
+    const uint8_t head[3] = { resp->seq, resp->method, resp->status };
+    if (resp->count > TP_RPC_MAX_VALUES) return 0;
+    return encode_rpc(TP_MSG_RPC_RESPONSE, head, sizeof(head), resp->value, resp->count, out, out_max);
+}
+
+bool tp_parse_rpc_response(const uint8_t *payload, size_t len, tp_rpc_response_t *out) {
+    if (len < 4 || payload[0] != TP_MSG_RPC_RESPONSE) return false;
+    out->seq = payload[1];
+    out->method = payload[2];
+    out->status = payload[3];
+    return parse_rpc_values(payload + 4, len - 4, out->value, &out->count, TP_RPC_MAX_VALUES);
+}
+
+// Lê um inteiro decimal com sinal; devolve o ponteiro após os dígitos ou NULL
+static const char *scan_int(const char *p, int32_t *out) {
+    bool neg = false;
+    uint32_t v = 0;
+
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '-' || *p == '+') neg = (*p++ == '-');
+    if (*p < '0' || *p > '9') return NULL;
+
+    uint32_t limit = neg ? 2147483648u : 2147483647u;
+    do {
+        uint32_t d = (uint32_t)(*p++ - '0');
+        if (v > (limit - d) / 10) return NULL;
+        v = v * 10 + d;
+    } while (*p >= '0' && *p <= '9');
+
+    *out = neg ? (int32_t)(0u - v) : (int32_t)v;
+    return p;
+}
+
+int tp_parse_int_list(const char *line, int32_t *out, int max) {
+    const char *p = line;
+    int n = 0;
+
+    for (;;) {
+        if (n >= max) return -1;
+        p = scan_int(p, &out[n]);
+        if (p == NULL) return -1;
+        n++;
+
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0') return n;
+        if (*p++ != ',') return -1;
+    }
+}
+
+bool tp_parse_tag_value(const char *line, int *tag, int32_t *value) {
+    int32_t fields[2];
+    if (tp_parse_int_list(line, fields, 2) != 2) return false;
+    *tag = fields[0];
+    *value = fields[1];
+    return true;
+}
+
+bool tp_parse_sweep_line(const char *line, tp_sweep_t *out) {
+    int32_t fields[TP_MAX_CHANNELS + 1];
+
+    if (line[0] != 'S' || line[1] != ',') return false;
+    int n = tp_parse_int_list(line + 2, fields, TP_MAX_CHANNELS + 1);
+    if (n < 1) return false;
+
+    out->host_ms = (uint32_t)fields[0];
+    out->count = (uint8_t)(n - 1);
+    for (int i = 0; i < out->count; i++) {
+        out->value[i] = fields[i + 1];
+    }
+    return true;
+}
+
+bool tp_parse_delta_line(const char *line, tp_delta_t *out) {
+    int32_t fields[TP_MAX_CHANNELS + 2];
+
+    if (line[0] != 'D' || line[1] != ',') return false;
+    int n = tp_parse_int_list(line + 2, fields, TP_MAX_CHANNELS + 2);
+    if (n < 2) return false;
+
+    out->host_ms = (uint32_t)fields[0];
+    out->mask = (uint32_t)fields[1];
+    if (out->mask >> TP_MAX_CHANNELS) return false;
+
+    int k = 2;
+    for (int i = 0; i < TP_MAX_CHANNELS; i++) {
+        if (!(out->mask & (1u << i))) continue;
+        if (k >= n) return false;
+        out->value[i] = fields[k++];
+    }
+    return k == n;
+}
+
+void tp_rx_init(tp_rx_t *rx) {
+    memset(rx, 0, sizeof(*rx));
+}
+
+static tp_rx_event_t finish_frame(tp_rx_t *rx) {
+    size_t n = tp_cobs_decode(rx->buf, rx->len, rx->payload, sizeof(rx->payload));
+    if (n < 3) {
+        rx->frames_bad_cobs++;
+        return TP_RX_NONE;
+    }
+    uint16_t crc = (uint16_t)(rx->payload[n - 2] | (rx->payload[n - 1] << 8));
+    if (tp_crc16(rx->payload, n - 2) != crc) {
+        rx->frames_bad_crc++;
+        return TP_RX_NONE;
+    }
+    rx->payload_len = n - 2;
+    rx->frames_ok++;
+    return TP_RX_FRAME;
+}
+
+tp_rx_event_t tp_rx_feed(tp_rx_t *rx, uint8_t c) {
+    tp_rx_event_t ev = TP_RX_NONE;
+
+    if (c == 0x00) {
+        if (rx->overflow) rx->overflows++;
+        if (rx->in_frame && rx->len > 0) {
+            // Delimitador final: valida o quadro e volta ao modo texto. Se o
+            // quadro não fecha, o 0x00 que o abriu pode ter sido ruído e este
+            // é o inicial do próximo quadro: continua no modo quadro
+            ev = finish_frame(rx);
+            rx->in_frame = (ev != TP_RX_FRAME);
+        } else {
+            // Delimitador inicial (ou 00 00, ponto de ressincronia):
+            // descarta qualquer linha parcial
+            rx->in_frame = true;
+        }
+        rx->len = 0;
+        rx->overflow = false;
+        return ev;
+    }
+
+    if (!rx->in_frame && (c == '\n' || c == '\r')) {
+        if (rx->len > 0 && !rx->overflow) {
+            memcpy(rx->line, rx->buf, rx->len);
+            rx->line[rx->len] = '\0';
+            ev = TP_RX_LINE;
+        } else if (rx->overflow) {
+            rx->overflows++;
+        }
+        rx->len = 0;
+        rx->overflow = false;
+        return ev;
+    }
+
+    size_t max = rx->in_frame ? sizeof(rx->buf) : sizeof(rx->line) - 1;
+    if (rx->len < max) {
+        rx->buf[rx->len++] = c;
+    } else if (rx->in_frame) {
+        // Nenhum quadro válido é tão longo: o 0x00 que abriu este era ruído
+        // ou o delimitador final se perdeu. Volta ao modo texto descartando
+        // até o próximo '\n', para não ficar fora de fase até outro 0x00.
+        rx->in_frame = false;
+        rx->len = 0;
+        if (c == '\n' || c == '\r') rx->overflows++;
+        else rx->overflow = true;
+    } else {
+        rx->overflow = true;
+    }
+    return ev;
+}
@@ -0,0 +1,327 @@
+/**
+ * @file telemetry_proto.h
+ * @brief Protocolo binário de telemetria (COBS + CRC-16) entre o get_rpm.py e o Pico
+ *
+ * Formato de um quadro no fio:
+ *
+ *     0x00 | COBS( tipo | corpo... | crc16_lo | crc16_hi ) | 0x00
+ *
+ * O CRC é CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) sobre tipo + corpo.
+ * No quadro de telemetria o corpo é uma sequência de canais, cada um com
+ * 1 byte de tag seguido do valor em varint zigzag (LEB128), de modo que
+ * uma varredura inteira de PIDs cabe em um único pacote USB.
+ *
+ * O quadro de varredura (TP_MSG_SWEEP) leva todos os canais de uma leitura
+ * OBD completa: timestamp do host em ms seguido dos valores, em varint
+ * zigzag, na ordem da coluna "sweep" de channels.csv (RPM, velocidade, IAT,
+ * consumo, arrefecimento, avanço, AFR). No protocolo de texto equivale à
+ * linha "S,ts,v0,v1,...".
+ *
+ * O quadro delta (TP_MSG_DELTA) leva só os canais que mudaram além da banda
+ * morta de cada um: timestamp, máscara de bits com as posições de varredura
+ * presentes e os valores dessas posições, em ordem crescente. O host manda
+ * uma varredura completa (keyframe) a cada N ms para que um Pico conectado
+ * depois, ou que perdeu quadros, volte a ter todos os canais. No protocolo de
+ * texto equivale à linha "D,ts,mascara,v...".
+ *
+ * Sonda de latência: TP_MSG_PROBE leva seq, há quanto tempo (us) o host
+ * recebeu a resposta OBD e canais tag/valor como no quadro de telemetria. O
+ * Pico aplica os canais e responde com TP_MSG_PROBE_ECHO quando o valor
+ * chegou aos LEDs e o display terminou o quadro seguinte, com o tempo de cada
+ * estágio contado a partir do parse (ver latency.h).
+ *
+ * RPC: o host manda TP_MSG_RPC_REQUEST (seq, método, argumentos em varint) e
+ * o Pico responde com TP_MSG_RPC_RESPONSE (seq, método, status, valores em
+ * varint). seq e método vão como bytes crus; o host casa a resposta pelo seq.
+ * Os significados dos argumentos e dos valores de cada método estão junto do
+ * enum tp_rpc_method_t.
+ *
+ * Mensagens do Pico para o host usam tipos a partir de 0x80. O quadro de
+ * status (TP_MSG_STATUS) é enviado periodicamente com a ocupação da fila de
+ * recepção e os contadores de perdas, para o get_rpm.py regular o envio.
+ *
+ * Assinatura (TP_MSG_SUBSCRIBE): o Pico diz quais canais a tela atual usa e
+ * com que taxa, em pares tag + varint da taxa em centi-Hz. Canal fora da
+ * lista não precisa ser lido; o get_rpm.py reorganiza o polling OBD a cada
+ * assinatura nova. O Pico manda ao trocar de tela e repete periodicamente,
+ * para um host que conectou depois.
+ *
+ * O byte 0x00 nunca aparece dentro de um quadro COBS e nunca aparece numa
+ * linha de texto, então o receptor (tp_rx_t) consegue separar os quadros
+ * binários das linhas "tag,valor" do protocolo antigo no mesmo fluxo.
+ *
+ * Este módulo não depende do Pico SDK e compila também no host.
+ */
+
+#ifndef TELEMETRY_PROTO_H
+#define TELEMETRY_PROTO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TP_MAX_CHANNELS 16   // Canais por quadro de telemetria
+#define TP_MAX_PAYLOAD  96   // tipo + corpo + CRC, antes do COBS
+#define TP_MAX_FRAME    (TP_MAX_PAYLOAD + TP_MAX_PAYLOAD / 254 + 1)
+#define TP_MAX_LINE     64   // Linha do protocolo de texto
+
+// Tipos de mensagem (primeiro byte do payload)
+typedef enum {
+    TP_MSG_TELEMETRY    = 0x01,
+    TP_MSG_SWEEP        = 0x02,
+    TP_MSG_DELTA        = 0x03,
+    TP_MSG_PROBE        = 0x04,
+    TP_MSG_RPC_REQUEST  = 0x10,
+
+    // Pico -> host
+    TP_MSG_STATUS       = 0x80,
+    TP_MSG_PROBE_ECHO   = 0x81,
+    TP_MSG_SUBSCRIBE    = 0x82,
+    TP_MSG_RPC_RESPONSE = 0x90,
+} tp_msg_type_t;
+
+#define TP_RPC_MAX_ARGS   4
+#define TP_RPC_MAX_VALUES 26
+
+// Métodos RPC: argumentos -> valores da resposta
+typedef enum {
+    TP_RPC_PING          = 0, // -> (nenhum)
+    TP_RPC_GET_PARAM     = 1, // id -> id, valor
+    TP_RPC_SET_PARAM     = 2, // id, valor -> id, valor aplicado
+    TP_RPC_GET_COUNTERS  = 3, // primeiro -> total, primeiro, valores... (tp_counter_t, até 12 por chamada)
+    TP_RPC_READ_HISTORY  = 4, // índice -> total, primeiro, n, n x (tag, valor, dt_us)
+    TP_RPC_RUN_BENCHMARK = 5, // id, iterações -> id, iterações feitas (para antes de ~20 ms), tempo total em us
+    TP_RPC_GET_CHANNELS  = 6, // primeiro -> total, primeiro, n x (tag, idade em ms ou -1, taxa em centi-Hz)
+    TP_RPC_GET_TASKS     = 7, // primeira -> total, primeira, n x (período, orçamento, execuções, overruns,
+                              //                                   prazos perdidos, máx us, última us)
+    TP_RPC_GET_PROFILE   = 8, // etapa, zerar -> etapa, clk_sys em kHz, n, mín, máx, média (ciclos),
+                              //                 PROF_BUCKETS x histograma log2 (ver profile.h)
+    TP_RPC_TRACE_CONTROL = 9, // ação (0 = parar, 1 = zerar e gravar) -> gravando, eventos do núcleo 0,
+                              //                                         eventos do núcleo 1, tamanho do ring
+    TP_RPC_READ_TRACE    = 10, // núcleo, índice -> total, primeiro, n, n x (dt_us, fase << 24 | evento << 16 | arg)
+                               // (ver trace.h; o primeiro dt é o tempo absoluto)
+    TP_RPC_GET_MEMORY    = 11, // -> 2 x pilha (usada, reservada, região), heap (em uso, livre, arena, limite),
+                               //    LVGL (total, livre, maior bloco livre, pico usado, fragmentação %, blocos)
+} tp_rpc_method_t;
+
+typedef enum {
+    TP_RPC_OK         = 0,
+    TP_RPC_ERR_METHOD = 1, // Método desconhecido
+    TP_RPC_ERR_ARGS   = 2, // Argumento ausente ou fora da faixa
+    TP_RPC_ERR_BUSY   = 3, // Fila de requisições cheia; repetir
+    TP_RPC_ERR_SIZE   = 4, // Valores da resposta não couberam num quadro (bug do firmware)
+} tp_rpc_status_t;
+
+// Bytes de varint disponíveis numa resposta RPC: payload menos tipo, CRC e seq/método/status
+#define TP_RPC_RESPONSE_VALUE_BYTES (TP_MAX_PAYLOAD - 3 - 3)
+#define TP_VARINT_MAX_BYTES 5
+
+// Parâmetros de TP_RPC_GET_PARAM / TP_RPC_SET_PARAM
+typedef enum {
+    TP_PARAM_RPM_TARGET = 0, // shift_light_rpm_target, 1000..9000
+    TP_PARAM_BRIGHTNESS = 1, // Brilho dos LEDs em milésimos, 0..1000
+    TP_PARAM_STALE_MS   = 2, // Idade a partir da qual um canal é considerado velho, 100..60000
+    TP_PARAM_HUD        = 3, // HUD de desempenho na tela (núcleos, FPS, flush, recepção, LVGL), 0/1
+} tp_param_t;
+
+// Contadores de TP_RPC_GET_COUNTERS, na ordem da resposta
+typedef enum {
+    TP_COUNTER_UPTIME_MS = 0,
+    TP_COUNTER_RX_BYTES,
+    TP_COUNTER_RX_MSGS,
+    TP_COUNTER_RX_OVERRUN_BYTES,
+    TP_COUNTER_RX_HIGH_WATER,
+    TP_COUNTER_FRAMES_OK,
+    TP_COUNTER_FRAMES_BAD_COBS,
+    TP_COUNTER_FRAMES_BAD_CRC,
+    TP_COUNTER_LINE_OVERFLOWS,
+    TP_COUNTER_CHANNEL_UPDATES,
+    TP_COUNTER_SAMPLE_DROPPED,
+    TP_COUNTER_LOOP_OVERRUNS,
+    TP_COUNTER_TX_QUEUED,
+    TP_COUNTER_TX_SENT,
+    TP_COUNTER_TX_DROPPED_FULL,
+    TP_COUNTER_TX_DROPPED_CLOSED,
+    TP_COUNTER_LOG_DROPPED_BYTES,
+    TP_COUNTER_RPC_BUSY,
+    TP_COUNTER_ELM_REQUESTS,     // Cliente ELM327 nativo (OBD_NATIVE_ELM327); 0 no modo get_rpm.py
+    TP_COUNTER_ELM_VALUES,
+    TP_COUNTER_ELM_NO_DATA,
+    TP_COUNTER_ELM_ERRORS,
+    TP_COUNTER_ELM_TIMEOUTS,
+    TP_COUNTER_ELM_LATENCY_US,   // Último pedido -> prompt
+    TP_COUNTER_CAN_FRAMES,       // Receptor CAN passivo (CAN_RX_ENABLED); quadros válidos de qualquer ID
+    TP_COUNTER_CAN_MATCHED,      // ...com ID da tabela de sinais
+    TP_COUNTER_CAN_STUFF_ERRORS,
+    TP_COUNTER_CAN_CRC_ERRORS,
+    TP_COUNTER_CAN_FORM_ERRORS,
+    TP_COUNTER_CAN_DROPPED,      // Ring de quadros cheio + FIFO do PIO cheio
+    TP_COUNTER_LED_WRITES,       // npWrite() feitos: só quando o RPM, o frescor ou um parâmetro muda
+    TP_COUNTER_LABEL_WRITES,     // Rótulos reescritos; texto igual não conta
+    TP_COUNTER_INPUT_DROPPED,    // Eventos de entrada descartados com a fila do input.h cheia
+    TP_COUNTER_RPC_TOO_BIG,      // Respostas RPC que não couberam num quadro (viram TP_RPC_ERR_SIZE)
+    TP_COUNTER_COUNT
+} tp_counter_t;
+
+// Micro-benchmarks de TP_RPC_RUN_BENCHMARK (rodam no núcleo 0)
+typedef enum {
+    TP_BENCH_CRC16 = 0,      // tp_crc16 sobre 64 bytes
+    TP_BENCH_COBS,           // tp_cobs_encode + tp_cobs_decode de 64 bytes
+    TP_BENCH_TEXT_LINE,      // tp_parse_tag_value de "1,3500"
+    TP_BENCH_CHANNEL_APPLY,  // telemetry_apply de uma varredura completa
+    TP_BENCH_CAN_DECODE,     // can_decoder_feed_word de um quadro de 8 bytes (~130 bits)
+    TP_BENCH_PROFILE,        // Uma medida de etapa: duas leituras do SysTick + profile_add
+    TP_BENCH_COUNT
+} tp_bench_t;
+
+typedef struct {
+    uint8_t tag;
+    int32_t value;
+} tp_channel_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t count;
+    tp_channel_t ch[TP_MAX_CHANNELS];
+} tp_telemetry_t;
+
+typedef struct {
+    uint32_t host_ms;
+    uint8_t count;
+    int32_t value[TP_MAX_CHANNELS]; // Na ordem de varredura de channels.csv
+} tp_sweep_t;
+
+typedef struct {
+    uint32_t host_ms;
+    uint32_t mask;                  // Bit i = posição de varredura i presente
+    int32_t value[TP_MAX_CHANNELS]; // Indexado pela posição; só vale com o bit ligado
+} tp_delta_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t obd_age_us;            // Resposta OBD -> envio, medido no host
+    uint8_t count;
+    tp_channel_t ch[TP_MAX_CHANNELS];
+} tp_probe_t;
+
+// Tempos em us a partir do parse da sonda no núcleo 1; -1 = estágio não aconteceu
+typedef struct {
+    uint32_t seq;
+    uint32_t obd_age_us;    // Devolvido como veio
+    int32_t applied_us;     // Snapshot publicado para o núcleo 0
+    int32_t led_us;         // npWrite() com o valor da sonda
+    int32_t flush_us;       // Primeiro quadro do display concluído depois dos LEDs
+    int32_t echo_us;        // Eco enfileirado para o host
+    uint32_t dropped;       // Sondas descartadas (outra ainda em andamento)
+} tp_probe_echo_t;
+
+typedef struct {
+    uint32_t rx_level;        // Bytes pendentes no ring de recepção USB
+    uint32_t rx_capacity;     // Tamanho do ring de recepção
+    uint32_t rx_dropped;      // Mensagens perdidas na entrada (overrun, COBS, CRC)
+    uint32_t sample_dropped;  // Amostras descartadas no ring núcleo 1 -> núcleo 0
+    uint32_t loop_overruns;   // Execuções de tarefas do núcleo 0 acima do orçamento (scheduler.h);
+                              // só informativo, não indica congestionamento da recepção
+    uint32_t rx_msgs_per_s;
+    uint32_t tx_dropped;      // Mensagens Pico -> host descartadas na fila de saída
+} tp_status_t;
+
+typedef struct {
+    uint8_t count;
+    uint8_t tag[TP_MAX_CHANNELS];
+    uint16_t rate_chz[TP_MAX_CHANNELS]; // Taxa desejada em centésimos de Hz
+} tp_subscription_t;
+
+typedef struct {
+    uint8_t seq;
+    uint8_t method;
+    uint8_t argc;
+    int32_t arg[TP_RPC_MAX_ARGS];
+} tp_rpc_request_t;
+
+typedef struct {
+    uint8_t seq;
+    uint8_t method;
+    uint8_t status;
+    uint8_t count;
+    int32_t value[TP_RPC_MAX_VALUES];
+} tp_rpc_response_t;
+
+// Resultado de tp_rx_feed()
+typedef enum {
+    TP_RX_NONE = 0,   // Byte consumido, nada completo ainda
+    TP_RX_LINE,       // Linha de texto completa em rx->line
+    TP_RX_FRAME,      // Quadro binário válido em rx->payload / rx->payload_len
+} tp_rx_event_t;
+
+// Receptor incremental que separa linhas de texto e quadros COBS
+typedef struct {
+    uint8_t buf[TP_MAX_FRAME];
+    size_t len;
+    bool in_frame;
+    bool overflow;
+
+    char line[TP_MAX_LINE];
+    uint8_t payload[TP_MAX_PAYLOAD];
+    size_t payload_len;
+
+    // Contadores de diagnóstico
+    uint32_t frames_ok;
+    uint32_t frames_bad_cobs;
+    uint32_t frames_bad_crc;
+    uint32_t overflows;
+} tp_rx_t;
+
+uint16_t tp_crc16(const uint8_t *data, size_t len);
+
+// Retornam o número de bytes escritos em dst (0 em caso de erro)
+size_t tp_cobs_encode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_max);
+size_t tp_cobs_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_max);
+
+// Monta o quadro completo (delimitadores incluídos) a partir de tipo + corpo
+size_t tp_encode_frame(uint8_t type, const uint8_t *body, size_t body_len, uint8_t *out, size_t out_max);
+size_t tp_encode_telemetry(const tp_channel_t *ch, size_t count, uint8_t *out, size_t out_max);
+
+// Interpreta o payload já validado (tipo + corpo, sem CRC) de um quadro de telemetria
+bool tp_parse_telemetry(const uint8_t *payload, size_t len, tp_telemetry_t *out);
+
+size_t tp_encode_sweep(const tp_sweep_t *sweep, uint8_t *out, size_t out_max);
+bool tp_parse_sweep(const uint8_t *payload, size_t len, tp_sweep_t *out);
+bool tp_parse_sweep_line(const char *line, tp_sweep_t *out);
+
+size_t tp_encode_delta(const tp_delta_t *delta, uint8_t *out, size_t out_max);
+bool tp_parse_delta(const uint8_t *payload, size_t len, tp_delta_t *out);
+bool tp_parse_delta_line(const char *line, tp_delta_t *out);
+
+size_t tp_encode_status(const tp_status_t *status, uint8_t *out, size_t out_max);
+
+size_t tp_encode_subscription(const tp_subscription_t *sub, uint8_t *out, size_t out_max);
+bool tp_parse_subscription(const uint8_t *payload, size_t len, tp_subscription_t *out);
+
+size_t tp_encode_probe(const tp_probe_t *probe, uint8_t *out, size_t out_max);
+bool tp_parse_probe(const uint8_t *payload, size_t len, tp_probe_t *out);
+size_t tp_encode_probe_echo(const tp_probe_echo_t *echo, uint8_t *out, size_t out_max);
+
+size_t tp_encode_rpc_request(const tp_rpc_request_t *req, uint8_t *out, size_t out_max);
+bool tp_parse_rpc_request(const uint8_t *payload, size_t len, tp_rpc_request_t *out);
+size_t tp_encode_rpc_response(const tp_rpc_response_t *resp, uint8_t *out, size_t out_max);
+bool tp_parse_rpc_response(const uint8_t *payload, size_t len, tp_rpc_response_t *out);
+
+// Protocolo de texto sem sscanf: interpreta "a,b,c..." em inteiros com sinal,
+// no próprio buffer e sem alocação. Retorna a quantidade de campos ou -1 se a
+// linha estiver malformada (campo vazio, caractere inválido, estouro de int32).
+int tp_parse_int_list(const char *line, int32_t *out, int max);
+bool tp_parse_tag_value(const char *line, int *tag, int32_t *value);
+
+void tp_rx_init(tp_rx_t *rx);
+tp_rx_event_t tp_rx_feed(tp_rx_t *rx, uint8_t c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_PROTO_H
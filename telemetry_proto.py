@@ -0,0 +1,523 @@
+"""Protocolo binário de telemetria entre o host e o Pico (espelho de telemetry_proto.h).
+
+Quadro: 0x00 | COBS(tipo | corpo | crc16 LE) | 0x00
+Tipos 0x01..0x7F vão do host para o Pico; 0x80 em diante, do Pico para o host.
+"""
+
+import time
+
+TP_MSG_TELEMETRY = 0x01
+TP_MSG_SWEEP = 0x02
+TP_MSG_DELTA = 0x03
+TP_MSG_PROBE = 0x04
+TP_MSG_RPC_REQUEST = 0x10
+TP_MSG_STATUS = 0x80
+TP_MSG_PROBE_ECHO = 0x81
+TP_MSG_SUBSCRIBE = 0x82
+TP_MSG_RPC_RESPONSE = 0x90
+
+# RPC (mesmos valores de tp_rpc_method_t / tp_rpc_status_t / tp_param_t / tp_bench_t)
+RPC_PING = 0
+RPC_GET_PARAM = 1
+RPC_SET_PARAM = 2
+RPC_GET_COUNTERS = 3
+RPC_READ_HISTORY = 4
+RPC_RUN_BENCHMARK = 5
+RPC_GET_CHANNELS = 6
+RPC_GET_TASKS = 7
+RPC_GET_PROFILE = 8
+RPC_TRACE_CONTROL = 9
+RPC_READ_TRACE = 10
+RPC_GET_MEMORY = 11
+
+RPC_OK = 0
+RPC_ERR_METHOD = 1
+RPC_ERR_ARGS = 2
+RPC_ERR_BUSY = 3
+RPC_ERR_SIZE = 4
+
+PARAMS = {"rpm_target": 0, "brightness": 1, "stale_ms": 2, "hud": 3}
+BENCHMARKS = {"crc16": 0, "cobs": 1, "text_line": 2, "channel_apply": 3, "can_decode": 4, "profile": 5}
+
+# Ordem de main_task_t em shift_light.c
+TASK_NAMES = ("leds", "input", "lvgl", "alerts", "labels", "link", "status", "subscription", "hud", "tests")
+
+# Ordem de prof_stage_t em profile.h; as quatro últimas são do núcleo 1
+PROFILE_STAGES = ("lvgl", "flush", "np_write", "label_text", "rpc", "usb_drain", "publish", "elm_poll", "can_drain")
+PROFILE_BUCKETS = 20  # Faixa 0: < 32 ciclos; faixa i: 2^(i+4) a 2^(i+5)-1
+
+# Ordem de trace_event_id_t e trace_phase_t em trace.h; "idle" aparece nos dois núcleos
+TRACE_EVENTS = ("task", "flush", "np_write", "sample_pop", "rpc", "beep", "input",
+                "usb_msg", "sample", "publish", "elm_poll", "can_pop", "idle")
+TRACE_PHASES = ("B", "E", "i")  # Mesmas letras do "ph" do formato de trace do Chrome
+
+# Ordem de tp_counter_t
+COUNTER_NAMES = (
+    "uptime_ms", "rx_bytes", "rx_msgs", "rx_overrun_bytes", "rx_high_water",
+    "frames_ok", "frames_bad_cobs", "frames_bad_crc", "line_overflows",
+    "channel_updates", "sample_dropped", "loop_overruns",
+    "tx_queued", "tx_sent", "tx_dropped_full", "tx_dropped_closed",
+    "log_dropped_bytes", "rpc_busy",
+    "elm_requests", "elm_values", "elm_no_data", "elm_errors", "elm_timeouts", "elm_latency_us",
+    "can_frames", "can_matched", "can_stuff_errors", "can_crc_errors", "can_form_errors", "can_dropped",
+    "led_writes", "label_writes", "input_dropped", "rpc_too_big",
+)
+
+# Dispositivo USB composto do firmware (usb_descriptors.c)
+PICO_USB_VID = 0x2E8A
+PICO_USB_PID = 0x4010
+PICO_DATA_INTERFACE = 2  # Interface CDC de telemetria; a 0 é a de logs (printf)
+
+
+def crc16_ccitt(data):
+    """CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), igual ao tp_crc16 do firmware."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(byte)
+            code += 1
+            if code == 0xFF:
+                out[code_pos] = code
+                code_pos = len(out)
+                out.append(0)
+                code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    """Retorna os bytes decodificados ou None se o bloco COBS for inválido."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_varint(value):
+    value = int(value)
+    v = ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF  # zigzag
+    out = bytearray()
+    while True:
+        byte = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def decode_varints(data):
+    """Lê uma sequência de varints zigzag; retorna a lista de inteiros."""
+    values = []
+    v = shift = 0
+    for byte in data:
+        v |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            values.append((v >> 1) ^ -(v & 1))
+            v = shift = 0
+    return values
+
+
+def encode_frame(msg_type, body):
+    payload = bytes([msg_type]) + bytes(body)
+    crc = crc16_ccitt(payload)
+    payload += bytes([crc & 0xFF, crc >> 8])
+    return b"\x00" + cobs_encode(payload) + b"\x00"
+
+
+def decode_frame(block):
+    """Valida um bloco COBS (sem delimitadores); retorna tipo + corpo ou None."""
+    payload = cobs_decode(block)
+    if payload is None or len(payload) < 3:
+        return None
+    crc = payload[-2] | (payload[-1] << 8)
+    if crc16_ccitt(payload[:-2]) != crc:
+        return None
+    return payload[:-2]
+
+
+def encode_delta(host_ms, mask, values):
+    """Quadro delta: timestamp, máscara das posições de varredura e os valores presentes."""
+    return encode_frame(TP_MSG_DELTA, encode_varint(host_ms) + encode_varint(mask)
+                        + b"".join(encode_varint(v) for v in values))
+
+
+def encode_rpc_request(seq, method, args=()):
+    body = bytes([seq & 0xFF, method]) + b"".join(encode_varint(a) for a in args)
+    return encode_frame(TP_MSG_RPC_REQUEST, body)
+
+
+def decode_rpc_response(payload):
+    """payload de TP_MSG_RPC_RESPONSE -> (seq, método, status, [valores])."""
+    return payload[1], payload[2], payload[3], decode_varints(payload[4:])
+
+
+def find_pico_data_port(default=None):
+    """Porta serial da interface de telemetria do Pico (não a de logs)."""
+    import serial.tools.list_ports
+
+    for port in serial.tools.list_ports.comports():
+        if port.vid != PICO_USB_VID or port.pid != PICO_USB_PID:
+            continue
+        # Linux/macOS expõem a string da interface; no Windows vem o número (x.2 / MI_02)
+        if port.interface and "telemetria" in port.interface:
+            return port.device
+        if (port.location or "").endswith(f".{PICO_DATA_INTERFACE}") or f"MI_{PICO_DATA_INTERFACE:02d}" in (port.hwid or ""):
+            return port.device
+    return default
+
+
+def encode_probe(seq, obd_age_us, updates=()):
+    """Sonda de latência; updates: lista de (tag, valor inteiro) aplicada como telemetria."""
+    body = bytearray(encode_varint(seq) + encode_varint(obd_age_us))
+    for tag, value in updates:
+        body.append(tag)
+        body += encode_varint(value)
+    return encode_frame(TP_MSG_PROBE, body)
+
+
+PROBE_ECHO_FIELDS = ("seq", "obd_age_us", "applied_us", "led_us", "flush_us", "echo_us", "dropped")
+
+
+def decode_probe_echo(payload):
+    return dict(zip(PROBE_ECHO_FIELDS, decode_varints(payload[1:])))
+
+
+class LatencyStats:
+    """Junta os ecos das sondas e calcula a latência de cada estágio.
+
+    Os tempos do Pico são relativos ao parse da sonda e o relógio dele não é o
+    do host, então o trecho host -> parse é estimado como metade do que sobra
+    do tempo de ida e volta depois de descontar o tempo dentro do Pico
+    (echo_us). Todos os estágios são contados a partir da notificação OBD
+    (obd_age_us mede a notificação -> envio no host).
+    """
+
+    STAGES = ("parsed", "applied", "led", "flush")
+
+    def __init__(self):
+        self.sent = {}
+        self.samples = {stage: [] for stage in self.STAGES}
+        self.lost_flush = 0
+        self.device_dropped = 0
+
+    def on_send(self, seq, t_send=None):
+        self.sent[seq] = time.perf_counter() if t_send is None else t_send
+        if len(self.sent) > 256:  # Sondas sem eco não acumulam para sempre
+            self.sent.pop(next(iter(self.sent)))
+
+    def on_echo(self, echo, t_recv=None):
+        t_recv = time.perf_counter() if t_recv is None else t_recv
+        t_send = self.sent.pop(echo["seq"], None)
+        if t_send is None:
+            return
+        self.device_dropped = echo["dropped"]
+        rtt_us = (t_recv - t_send) * 1e6
+        one_way_us = max(0.0, (rtt_us - echo["echo_us"]) / 2)
+        base = echo["obd_age_us"] + one_way_us
+        self.samples["parsed"].append(base)
+        self.samples["applied"].append(base + echo["applied_us"])
+        self.samples["led"].append(base + echo["led_us"])
+        if echo["flush_us"] >= 0:
+            self.samples["flush"].append(base + echo["flush_us"])
+        else:
+            self.lost_flush += 1
+
+    @staticmethod
+    def percentile(sorted_values, p):
+        if not sorted_values:
+            return float("nan")
+        k = min(len(sorted_values) - 1, max(0, round(p / 100 * (len(sorted_values) - 1))))
+        return sorted_values[k]
+
+    def report(self, histogram=True):
+        """Texto com p50/p99/máx por estágio e um histograma log2 em ms."""
+        lines = [f"{'estágio':8s} {'n':>6s} {'p50 ms':>8s} {'p99 ms':>8s} {'máx ms':>8s}"]
+        for stage in self.STAGES:
+            values = sorted(self.samples[stage])
+            lines.append(f"{stage:8s} {len(values):6d} {self.percentile(values, 50) / 1000:8.2f} "
+                         f"{self.percentile(values, 99) / 1000:8.2f} {(values[-1] if values else float('nan')) / 1000:8.2f}")
+        if histogram:
+            for stage in self.STAGES:
+                values = self.samples[stage]
+                if not values:
+                    continue
+                lines.append(f"\n{stage} (notificação OBD -> estágio):")
+                buckets = {}
+                for v in values:
+                    ms = v / 1000
+                    b = 0 if ms < 1 else int(ms).bit_length()  # [0,1), [1,2), [2,4), [4,8)...
+                    buckets[b] = buckets.get(b, 0) + 1
+                peak = max(buckets.values())
+                for b in range(max(buckets) + 1):
+                    lo, hi = (0, 1) if b == 0 else (1 << (b - 1), 1 << b)
+                    count = buckets.get(b, 0)
+                    lines.append(f"  {lo:5d}-{hi:<5d} ms {count:6d} {'#' * max(1 if count else 0, count * 40 // peak)}")
+        if self.lost_flush or self.device_dropped:
+            lines.append(f"\nsem quadro do display: {self.lost_flush}, sondas descartadas no Pico: {self.device_dropped}")
+        return "\n".join(lines)
+
+
+def decode_subscription(payload):
+    """payload de TP_MSG_SUBSCRIBE -> {tag: taxa em Hz}."""
+    rates = {}
+    i = 1
+    while i < len(payload):
+        tag = payload[i]
+        i += 1
+        v = shift = 0
+        while i < len(payload):
+            byte = payload[i]
+            i += 1
+            v |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        rates[tag] = ((v >> 1) ^ -(v & 1)) / 100
+    return rates
+
+
+class PollScheduler:
+    """Escolhe o próximo canal a pedir ao OBD a partir da assinatura do Pico.
+
+    Cada canal tem um prazo (última leitura + 1/taxa) e o próximo pedido é
+    sempre o de prazo mais antigo. Se as taxas somadas passam do que o
+    adaptador aguenta, todos atrasam na mesma proporção em vez de algum
+    canal parar. Até chegar a primeira assinatura (firmware antigo) valem as
+    taxas padrão.
+    """
+
+    def __init__(self, default_rates):
+        self.rates = {}
+        self.next_due = {}
+        self.subscribed = False
+        self.set_rates(default_rates)
+
+    def set_rates(self, rates, now=None):
+        """rates: {nome do canal: Hz}. Retorna True se a assinatura mudou."""
+        now = time.monotonic() if now is None else now
+        rates = {name: hz for name, hz in rates.items() if hz > 0}
+        if rates == self.rates:
+            return False
+        # Canal que continua mantém o prazo; canal novo é lido já
+        self.next_due = {name: self.next_due.get(name, now) for name in rates}
+        self.rates = rates
+        return True
+
+    def subscribe(self, rates, now=None):
+        self.subscribed = True
+        return self.set_rates(rates, now)
+
+    def next_channel(self, now=None):
+        """Retorna (canal, segundos até o prazo) ou (None, 0) sem canais assinados."""
+        if not self.next_due:
+            return None, 0.0
+        now = time.monotonic() if now is None else now
+        name = min(self.next_due, key=self.next_due.get)
+        return name, max(0.0, self.next_due[name] - now)
+
+    def polled(self, name, now=None):
+        now = time.monotonic() if now is None else now
+        if name in self.rates:
+            self.next_due[name] = now + 1.0 / self.rates[name]
+
+
+STATUS_FIELDS = ("rx_level", "rx_capacity", "rx_dropped", "sample_dropped", "loop_overruns", "rx_msgs_per_s",
+                 "tx_dropped")
+
+
+def decode_status(payload):
+    values = decode_varints(payload[1:])
+    return dict(zip(STATUS_FIELDS, values))
+
+
+class PicoLinkReader:
+    """Separa as linhas de texto (START_LOG, ...) dos quadros COBS vindos do Pico."""
+
+    MAX_FRAME = 256  # Bem acima do maior quadro do Pico (TP_MAX_FRAME)
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.in_frame = False
+        self.bad_frames = 0
+
+    def feed(self, data):
+        """Consome bytes recebidos; retorna lista de ("line", str) e ("frame", payload)."""
+        events = []
+        for byte in data:
+            if byte == 0:
+                if self.in_frame and self.buf:
+                    payload = decode_frame(bytes(self.buf))
+                    if payload is None:
+                        # O 0x00 que abriu o bloco pode ter sido ruído: este
+                        # passa a ser o inicial do próximo quadro
+                        self.bad_frames += 1
+                    else:
+                        events.append(("frame", payload))
+                        self.in_frame = False
+                else:
+                    self.in_frame = True
+                self.buf.clear()
+            elif not self.in_frame and byte in (0x0A, 0x0D):
+                if self.buf:
+                    events.append(("line", self.buf.decode("utf-8", errors="replace").strip()))
+                self.buf.clear()
+            elif self.in_frame and len(self.buf) >= self.MAX_FRAME:
+                # Quadro impossível de tão longo: volta ao modo texto
+                self.bad_frames += 1
+                self.in_frame = False
+                self.buf.clear()
+            else:
+                self.buf.append(byte)
+        return events
+
+
+class DeltaEncoder:
+    """Decide entre varredura completa (keyframe) e delta a cada leitura OBD.
+
+    Um canal só entra no delta quando se afasta do último valor enviado mais
+    que a sua banda morta (coluna "deadband" de channels.csv), então a
+    comparação é sempre contra o que o Pico tem e o erro nunca acumula. A
+    cada keyframe_interval segundos vai uma varredura completa, para um Pico
+    que conectou depois ou perdeu quadros voltar a ter todos os canais.
+
+    Canal com valor None (PID sem resposta recente) não é enviado nem no
+    keyframe, que nesse caso vai como delta com os canais presentes: o Pico
+    vê o canal envelhecer em vez de receber o último valor repetido.
+    """
+
+    def __init__(self, sweep, keyframe_interval=1.0):
+        self.sweep = sweep
+        self.keyframe_interval = keyframe_interval
+        self.sent = None
+        self.last_keyframe = 0.0
+        self.keyframes = 0
+        self.deltas = 0
+        self.suppressed = 0
+
+    def force_keyframe(self):
+        self.sent = None
+
+    def update(self, values, now=None):
+        """values: inteiros do fio na ordem de self.sweep.
+
+        Retorna ("keyframe", values), ("delta", mask, valores) ou None se nada mudou.
+        """
+        now = time.monotonic() if now is None else now
+        keyframe_due = self.sent is None or now - self.last_keyframe >= self.keyframe_interval
+        if self.sent is None:
+            self.sent = [None] * len(self.sweep)
+        if keyframe_due:
+            self.last_keyframe = now
+            self.keyframes += 1
+            if None not in values:
+                self.sent = list(values)
+                return ("keyframe", list(values))
+
+        mask = 0
+        changed = []
+        for i, (channel, value) in enumerate(zip(self.sweep, values)):
+            if value is None:
+                continue
+            if keyframe_due or self.sent[i] is None or abs(value - self.sent[i]) > channel.deadband:
+                mask |= 1 << i
+                changed.append(value)
+                self.sent[i] = value
+        if not mask:
+            self.suppressed += 1
+            return None
+        if not keyframe_due:
+            self.deltas += 1
+        return ("delta", mask, changed)
+
+
+class SendRateController:
+    """Regula o envio ao Pico a partir dos quadros de status (AIMD).
+
+    Sem congestionamento cada mensagem é escrita assim que chega. Quando o Pico
+    reporta fila de recepção acima da metade ou novas perdas na entrada, o
+    intervalo mínimo entre escritas dobra e as mensagens pendentes passam a ser
+    agrupadas numa única escrita USB, sem descartar nenhuma até MAX_PENDING.
+
+    Além disso a mais antiga é descartada e contada em dropped, e on_drop é
+    chamado: quem envia deltas deve forçar um keyframe ali, senão o canal do
+    delta perdido fica velho no Pico até o próximo keyframe.
+    """
+
+    MIN_INTERVAL = 0.0
+    MAX_INTERVAL = 0.5
+    FIRST_BACKOFF = 0.02
+    RECOVERY_STEP = 0.005
+    MAX_PENDING = 32
+
+    def __init__(self, on_drop=None):
+        self.interval = self.MIN_INTERVAL
+        self.pending = []
+        self.last_write = 0.0
+        self.last_status = None
+        self.dropped = 0
+        self.on_drop = on_drop
+
+    def submit(self, data):
+        self.pending.append(data)
+        if len(self.pending) > self.MAX_PENDING:
+            self.pending.pop(0)
+            self.dropped += 1
+            print(f"⚠️ Fila de envio cheia: mensagem mais antiga descartada ({self.dropped} no total)")
+            if self.on_drop is not None:
+                self.on_drop()
+
+    def flush_if_due(self, ser):
+        if not self.pending:
+            return
+        now = time.monotonic()
+        if now - self.last_write < self.interval:
+            return
+        ser.write(b"".join(self.pending))
+        self.pending.clear()
+        self.last_write = now
+
+    def on_status(self, status):
+        previous = self.last_status
+        self.last_status = status
+
+        congested = status["rx_level"] * 2 > status["rx_capacity"]
+        if previous is not None:
+            # loop_overruns fica de fora: também sobe com LVGL, beep e benchmark
+            # RPC no núcleo 0, que nada têm a ver com a recepção
+            for key in ("rx_dropped", "sample_dropped"):
+                if status[key] > previous[key]:
+                    congested = True
+
+        if congested:
+            self.interval = min(max(self.interval * 2, self.FIRST_BACKOFF), self.MAX_INTERVAL)
+            print(f"🐢 Pico congestionado ({status}); intervalo de envio {self.interval * 1000:.0f} ms")
+        else:
+            self.interval = max(self.interval - self.RECOVERY_STEP, self.MIN_INTERVAL)
@@ -0,0 +1,65 @@
+/**
+ * @file trace.c
+ * @brief Rings de eventos por núcleo (ver trace.h)
+ */
+
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#define TRACE_MASK (TRACE_RING_SIZE - 1)
+
+typedef struct {
+    trace_event_t ev[TRACE_RING_SIZE];
+    volatile uint32_t head; // Total gravado desde trace_start(); só o núcleo dono escreve
+} trace_ring_t;
+
+volatile bool trace_running = false;
+static trace_ring_t rings[TRACE_CORES];
+
+void trace_start(void) {
+    trace_running = false;
+    __dmb();
+    // O outro núcleo pode estar no meio de um trace_record() que viu a flag
+    // ligada; no pior caso sobra um evento dele no começo do ring
+    for (int core = 0; core < TRACE_CORES; core++) rings[core].head = 0;
+    __dmb();
+    trace_running = true;
+}
+
+void trace_stop(void) {
+    trace_running = false;
+    __dmb();
+}
+
+void trace_record(uint8_t phase, uint8_t id, uint16_t arg) {
+    trace_ring_t *r = &rings[get_core_num()];
+    uint32_t irq = save_and_disable_interrupts();
+    trace_event_t *e = &r->ev[r->head & TRACE_MASK];
+
+    e->t_us = time_us_32();
+    e->arg = arg;
+    e->id = id;
+    e->phase = phase;
+    r->head = r->head + 1;
+    restore_interrupts(irq);
+}
+
+uint32_t trace_total(unsigned core) {
+    return core < TRACE_CORES ? rings[core].head : 0;
+}
+
+size_t trace_copy_from(unsigned core, uint32_t *first, trace_event_t *out, size_t max) {
+    if (core >= TRACE_CORES) return 0;
+    const trace_ring_t *r = &rings[core];
+    uint32_t head = r->head;
+    __dmb();
+
+    uint32_t oldest = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    if (*first < oldest) *first = oldest;
+    if (*first > head) *first = head;
+
+    size_t n = 0;
+    for (uint32_t i = *first; i != head && n < max; i++) out[n++] = r->ev[i & TRACE_MASK];
+    return n;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file trace.h
+ * @brief Rastro de eventos com timestamp dos dois núcleos, para ver no Perfetto
+ *
+ * Complementa o profile.h: o perfil dá a distribuição de cada etapa, o
+ * rastro mostra quando cada coisa aconteceu e como os núcleos se intercalam
+ * (amostra chegando no núcleo 1, ring esvaziado no núcleo 0, flush, beep...).
+ *
+ * Cada núcleo grava no próprio ring de TRACE_RING_SIZE eventos de 8 bytes
+ * (tempo em us do timer do sistema, comum aos dois núcleos, fase, evento e
+ * um argumento de 16 bits); cheio, o mais antigo é sobrescrito. Só o núcleo
+ * dono escreve, com IRQs desligadas durante a gravação porque handlers do
+ * mesmo núcleo também marcam eventos.
+ *
+ * A gravação só acontece entre trace_start() e trace_stop(), os dois pelo
+ * RPC TP_RPC_TRACE_CONTROL; parado, cada marcação custa um teste de flag. O
+ * host lê os rings com TP_RPC_READ_TRACE depois de parar e converte para o
+ * JSON do Chrome/Perfetto (pico_rpc.py trace, trace_export.py).
+ *
+ * Só as marcações dependem deste cabeçalho, que não usa o Pico SDK (o
+ * scheduler.c continua compilando no host com TRACE_ENABLED 0). Com
+ * TRACE_ENABLED 0 elas somem do binário.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#define TRACE_RING_SIZE 4096 // Eventos por núcleo, potência de 2 (32 KB por núcleo)
+#define TRACE_CORES     2
+
+// Fase do evento, como o "ph" do formato do Chrome
+typedef enum {
+    TRACE_PH_BEGIN = 0,
+    TRACE_PH_END,
+    TRACE_PH_INSTANT,
+} trace_phase_t;
+
+// A ordem é a de TRACE_EVENTS em telemetry_proto.py
+typedef enum {
+    TRACE_TASK = 0,    // Núcleo 0: tarefa do escalonador; arg = índice em main_tasks
+    TRACE_FLUSH,       // Núcleo 0: disp_flush_cb; arg = linhas da área
+    TRACE_NP_WRITE,    // Núcleo 0: npWrite
+    TRACE_SAMPLE_POP,  // Núcleo 0: ring de amostras esvaziado; arg = amostras tiradas
+    TRACE_RPC,         // Núcleo 0: handle_rpc; arg = método
+    TRACE_BEEP,        // Núcleo 0: main_audio (bloqueia o núcleo durante o beep)
+    TRACE_INPUT,       // Núcleo 0: evento na fila do input.h, na IRQ; arg = input_event_t
+    TRACE_USB_MSG,     // Núcleo 1: handle_message; arg = tipo do quadro, 0 = linha de texto
+    TRACE_SAMPLE,      // Núcleo 1: canal aplicado; arg = tag
+    TRACE_PUBLISH,     // Núcleo 1: telemetry_publish; arg = 16 bits baixos da versão
+    TRACE_ELM_POLL,    // Núcleo 1: core1_poll_elm
+    TRACE_CAN_POP,     // Núcleo 1: quadro tirado do ring do CAN; arg = 16 bits baixos do ID
+    TRACE_IDLE,        // Os dois: dormindo em __wfe() (cpu_idle_begin/end)
+    TRACE_EVENT_COUNT
+} trace_event_id_t;
+
+typedef struct {
+    uint32_t t_us;
+    uint16_t arg;
+    uint8_t id;     // trace_event_id_t
+    uint8_t phase;  // trace_phase_t
+} trace_event_t;
+
+extern volatile bool trace_running;
+
+// Núcleo 0: zera os dois rings e começa a gravar / para de gravar
+void trace_start(void);
+void trace_stop(void);
+
+// Grava no ring do núcleo atual; use as macros abaixo
+void trace_record(uint8_t phase, uint8_t id, uint16_t arg);
+
+// Eventos gravados no ring do núcleo desde trace_start(), inclusive os já sobrescritos
+uint32_t trace_total(unsigned core);
+
+// Copia a partir do índice absoluto *first (contado desde trace_start()); se
+// ele já foi sobrescrito, avança *first até o evento mais antigo disponível
+size_t trace_copy_from(unsigned core, uint32_t *first, trace_event_t *out, size_t max);
+
+#if TRACE_ENABLED
+#define TRACE_MARK(phase, id, arg) \
+    do { if (trace_running) trace_record((phase), (id), (uint16_t)(arg)); } while (0)
+#else
+#define TRACE_MARK(phase, id, arg) ((void)0)
+#endif
+
+#define TRACE_BEGIN(id, arg)   TRACE_MARK(TRACE_PH_BEGIN, id, arg)
+#define TRACE_END(id, arg)     TRACE_MARK(TRACE_PH_END, id, arg)
+#define TRACE_INSTANT(id, arg) TRACE_MARK(TRACE_PH_INSTANT, id, arg)
+
+#endif // TRACE_H
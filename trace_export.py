@@ -0,0 +1,113 @@
+"""Converte um dump dos rings de trace do Pico (pico_rpc.py trace) para o JSON do Chrome/Perfetto.
+
+Exemplos:
+    python pico_rpc.py trace 5 -o captura.json   # grava 5 s, salva captura.bin e captura.json
+    python trace_export.py captura.bin           # refaz o JSON a partir do dump
+
+O JSON abre em https://ui.perfetto.dev ou em chrome://tracing, com uma linha
+por núcleo. Formato do dump: TRACE_MAGIC, depois, para cada núcleo, núcleo
+(u8), total gravado e quantidade no dump (u32 cada) e os eventos como estão
+na memória do Pico (trace_event_t em trace.h: t_us u32, arg u16, evento u8,
+fase u8, little-endian).
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+import channels
+from telemetry_proto import TASK_NAMES, TRACE_EVENTS, TRACE_PHASES
+
+TRACE_MAGIC = b"SLTRACE1"
+CORE_HEADER = struct.Struct("<BII")
+EVENT = struct.Struct("<IHBB")
+
+
+def write_dump(path, cores):
+    """cores: {núcleo: (total, [(t_us, fase, evento, arg), ...])}."""
+    with open(path, "wb") as f:
+        f.write(TRACE_MAGIC)
+        for core, (total, events) in sorted(cores.items()):
+            f.write(CORE_HEADER.pack(core, total, len(events)))
+            for t_us, phase, event, arg in events:
+                f.write(EVENT.pack(t_us, arg, event, phase))
+
+
+def read_dump(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith(TRACE_MAGIC):
+        raise ValueError(f"{path}: não é um dump de trace")
+    cores = {}
+    pos = len(TRACE_MAGIC)
+    while pos < len(data):
+        core, total, count = CORE_HEADER.unpack_from(data, pos)
+        pos += CORE_HEADER.size
+        events = []
+        for _ in range(count):
+            t_us, arg, event, phase = EVENT.unpack_from(data, pos)
+            pos += EVENT.size
+            events.append((t_us, phase, event, arg))
+        cores[core] = (total, events)
+    return cores
+
+
+def event_name(event, arg):
+    name = TRACE_EVENTS[event] if event < len(TRACE_EVENTS) else f"evento {event}"
+    if name == "task" and arg < len(TASK_NAMES):
+        return TASK_NAMES[arg]
+    if name == "sample":
+        channel = channels.BY_TAG.get(arg)
+        return f"sample {channel.name if channel else arg}"
+    return name
+
+
+def to_chrome(cores):
+    """Dump -> dict no formato JSON de trace do Chrome (timestamps em us desde o primeiro evento)."""
+    # Timer de 32 bits: o começo é o primeiro evento de algum núcleo, comparado com folga para a volta
+    firsts = [events[0][0] for _, events in cores.values() if events]
+    t0 = min(firsts, key=lambda t: (t - firsts[0] + 0x80000000) & 0xFFFFFFFF) if firsts else 0
+
+    out = [{"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "Shift Light (RP2040)"}}]
+    lost = {}
+    for core, (total, events) in sorted(cores.items()):
+        out.append({"ph": "M", "pid": 1, "tid": core, "name": "thread_name", "args": {"name": f"núcleo {core}"}})
+        lost[f"núcleo {core}"] = total - len(events)
+        depth = 0
+        for t_us, phase, event, arg in events:
+            ph = TRACE_PHASES[phase]
+            if ph == "E":
+                if depth == 0:
+                    continue  # O begin foi sobrescrito no ring
+                depth -= 1
+            elif ph == "B":
+                depth += 1
+            entry = {"ph": ph, "pid": 1, "tid": core, "ts": (t_us - t0) & 0xFFFFFFFF,
+                     "name": event_name(event, arg), "args": {"arg": arg}}
+            if ph == "i":
+                entry["s"] = "t"
+            out.append(entry)
+    return {"traceEvents": out, "displayTimeUnit": "ms", "otherData": {"eventos_sobrescritos": lost}}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", help="arquivo .bin gravado pelo pico_rpc.py trace")
+    parser.add_argument("-o", "--output", help="JSON de saída (padrão: mesmo nome com .json)")
+    args = parser.parse_args()
+
+    output = args.output or args.dump.rsplit(".", 1)[0] + ".json"
+    try:
+        cores = read_dump(args.dump)
+    except (OSError, ValueError, struct.error) as e:
+        sys.exit(str(e))
+    with open(output, "w") as f:
+        json.dump(to_chrome(cores), f)
+    for core, (total, events) in sorted(cores.items()):
+        print(f"núcleo {core}: {len(events)} eventos ({total - len(events)} sobrescritos)")
+    print(f"{output}: abra em https://ui.perfetto.dev")
+
+
+if __name__ == "__main__":
+    main()
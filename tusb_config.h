@@ -0,0 +1,36 @@
+/**
+ * @file tusb_config.h
+ * @brief Configuração do TinyUSB para o dispositivo composto (ver usb_link.h)
+ *
+ * Substitui a configuração do pico_stdio_usb: duas interfaces CDC, a 0 para
+ * logs (stdio) e a 1 para telemetria e controle.
+ */
+
+#ifndef _TUSB_CONFIG_H_
+#define _TUSB_CONFIG_H_
+
+#define CFG_TUSB_RHPORT0_MODE   (OPT_MODE_DEVICE)
+
+#ifndef CFG_TUSB_MEM_SECTION
+#define CFG_TUSB_MEM_SECTION
+#endif
+
+#ifndef CFG_TUSB_MEM_ALIGN
+#define CFG_TUSB_MEM_ALIGN      __attribute__ ((aligned(4)))
+#endif
+
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_CDC             2
+#define CFG_TUD_MSC             0
+#define CFG_TUD_HID             0
+#define CFG_TUD_MIDI            0
+#define CFG_TUD_VENDOR          0
+
+// Compartilhado pelas duas interfaces; a recepção de telemetria vai direto
+// para o ring de usb_rx.c, então o FIFO do TinyUSB só precisa de folga
+#define CFG_TUD_CDC_RX_BUFSIZE  256
+#define CFG_TUD_CDC_TX_BUFSIZE  256
+#define CFG_TUD_CDC_EP_BUFSIZE  64
+
+#endif // _TUSB_CONFIG_H_
@@ -0,0 +1,111 @@
+/**
+ * @file usb_descriptors.c
+ * @brief Descritores USB do dispositivo composto (duas interfaces CDC, ver usb_link.h)
+ */
+
+#include <string.h>
+#include "tusb.h"
+#include "pico/unique_id.h"
+#include "usb_link.h"
+
+#define USB_VID 0x2E8A // Raspberry Pi
+#define USB_PID 0x4010 // Diferente do stdio_usb (0x000A): o layout de interfaces mudou
+#define USB_BCD 0x0200
+
+enum {
+    ITF_NUM_CDC_LOG = 0,
+    ITF_NUM_CDC_LOG_DATA,
+    ITF_NUM_CDC_TELE,
+    ITF_NUM_CDC_TELE_DATA,
+    ITF_NUM_TOTAL
+};
+
+#define EPNUM_CDC_LOG_NOTIF  0x81
+#define EPNUM_CDC_LOG_OUT    0x02
+#define EPNUM_CDC_LOG_IN     0x82
+#define EPNUM_CDC_TELE_NOTIF 0x83
+#define EPNUM_CDC_TELE_OUT   0x04
+#define EPNUM_CDC_TELE_IN    0x84
+
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + CFG_TUD_CDC * TUD_CDC_DESC_LEN)
+
+enum {
+    STRID_LANGID = 0,
+    STRID_MANUFACTURER,
+    STRID_PRODUCT,
+    STRID_SERIAL,
+    STRID_CDC_LOG,
+    STRID_CDC_TELE,
+};
+
+static const tusb_desc_device_t desc_device = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = USB_BCD,
+    // IAD: cada CDC agrupa suas duas interfaces
+    .bDeviceClass = TUSB_CLASS_MISC,
+    .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = USB_VID,
+    .idProduct = USB_PID,
+    .bcdDevice = 0x0100,
+    .iManufacturer = STRID_MANUFACTURER,
+    .iProduct = STRID_PRODUCT,
+    .iSerialNumber = STRID_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+static const uint8_t desc_configuration[] = {
+    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0, 250),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC_LOG, STRID_CDC_LOG, EPNUM_CDC_LOG_NOTIF, 8,
+                       EPNUM_CDC_LOG_OUT, EPNUM_CDC_LOG_IN, CFG_TUD_CDC_EP_BUFSIZE),
+    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC_TELE, STRID_CDC_TELE, EPNUM_CDC_TELE_NOTIF, 8,
+                       EPNUM_CDC_TELE_OUT, EPNUM_CDC_TELE_IN, CFG_TUD_CDC_EP_BUFSIZE),
+};
+
+static const char *const string_desc[] = {
+    [STRID_MANUFACTURER] = "Raspberry Pi",
+    [STRID_PRODUCT] = "Shift Light",
+    [STRID_SERIAL] = NULL, // ID único da flash
+    [STRID_CDC_LOG] = "Shift Light log",
+    [STRID_CDC_TELE] = "Shift Light telemetria",
+};
+
+const uint8_t *tud_descriptor_device_cb(void) {
+    return (const uint8_t *)&desc_device;
+}
+
+const uint8_t *tud_descriptor_configuration_cb(uint8_t index) {
+    (void)index;
+    return desc_configuration;
+}
+
+const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
+    static uint16_t desc_str[33];
+    static char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+    (void)langid;
+
+    uint8_t len;
+    if (index == STRID_LANGID) {
+        desc_str[1] = 0x0409; // Inglês (EUA)
+        len = 1;
+    } else {
+        if (index >= sizeof(string_desc) / sizeof(string_desc[0])) return NULL;
+
+        const char *str = string_desc[index];
+        if (index == STRID_SERIAL) {
+            if (!serial[0]) pico_get_unique_board_id_string(serial, sizeof(serial));
+            str = serial;
+        }
+
+        len = (uint8_t)strlen(str);
+        if (len > 32) len = 32;
+        for (uint8_t i = 0; i < len; i++) {
+            desc_str[1 + i] = (uint8_t)str[i];
+        }
+    }
+
+    desc_str[0] = (uint16_t)((TUSB_DESC_STRING << 8) | (2 * len + 2));
+    return desc_str;
+}
@@ -0,0 +1,212 @@
+/**
+ * @file usb_link.c
+ * @brief Implementação do dispositivo USB composto (ver usb_link.h)
+ */
+
+#include <string.h>
+#include "usb_link.h"
+#include "telemetry_proto.h"
+#include "pico/stdlib.h"
+#include "pico/stdio/driver.h"
+#include "pico/mutex.h"
+#include "pico/bootrom.h"
+#include "pico/multicore.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+
+#define USB_TASK_INTERVAL_US 10000 // Repescagem: mutex ocupado ou FIFO cheio no último disparo
+#define QUEUE_MASK (USB_LINK_QUEUE_DEPTH - 1)
+
+_Static_assert(USB_LINK_MSG_MAX >= TP_MAX_FRAME + 2, "fila de saída não comporta um quadro completo");
+
+typedef struct {
+    uint8_t len;
+    uint8_t data[USB_LINK_MSG_MAX];
+} tx_msg_t;
+
+// Fila SPSC de um núcleo; índices livres, cada um com um único escritor
+typedef struct {
+    tx_msg_t slot[USB_LINK_QUEUE_DEPTH];
+    volatile uint32_t head;      // Escrito pelo núcleo produtor
+    volatile uint32_t tail;      // Escrito pela IRQ do USB
+    volatile uint32_t queued;
+    volatile uint32_t dropped_full;
+    volatile uint32_t high_water;
+} tx_queue_t;
+
+static tx_queue_t tx_queue[2];
+
+// tud_task (IRQ) e o printf do loop principal rodam no mesmo núcleo; a IRQ
+// só tenta pegar o mutex e, se o loop estiver escrevendo, fica para o próximo disparo
+static mutex_t usb_mutex;
+static uint8_t usb_task_irq;
+static struct repeating_timer usb_task_timer;
+
+// Escritos só pela IRQ do USB
+static volatile uint32_t tx_sent;
+static volatile uint32_t tx_dropped_closed;
+// Escrito por quem chama printf, em qualquer núcleo (contagem aproximada)
+static volatile uint32_t log_dropped_bytes;
+
+// Contexto da IRQ, com usb_mutex: passa o que couber das filas para o FIFO do TinyUSB
+static void drain_tx_queues(void) {
+    bool connected = usb_link_data_connected();
+    bool wrote = false;
+
+    for (int core = 0; core < 2; core++) {
+        tx_queue_t *q = &tx_queue[core];
+        uint32_t tail = q->tail;
+
+        while (tail != q->head) {
+            const tx_msg_t *msg = &q->slot[tail & QUEUE_MASK];
+            if (!connected) {
+                tx_dropped_closed++;
+            } else if (tud_cdc_n_write_available(USB_LINK_CDC_DATA) >= msg->len) {
+                tud_cdc_n_write(USB_LINK_CDC_DATA, msg->data, msg->len);
+                tx_sent++;
+                wrote = true;
+            } else {
+                break; // FIFO cheio: o resto fica para o próximo disparo
+            }
+            tail++;
+        }
+
+        __dmb(); // Terminou de ler os slots antes de liberá-los
+        q->tail = tail;
+    }
+
+    if (wrote) tud_cdc_n_write_flush(USB_LINK_CDC_DATA);
+}
+
+static void usb_task_irq_handler(void) {
+    if (mutex_try_enter(&usb_mutex, NULL)) {
+        tud_task();
+        drain_tx_queues();
+        mutex_exit(&usb_mutex);
+    }
+}
+
+// Roda logo depois do handler do TinyUSB: há evento novo para o tud_task
+static void usb_ctrl_irq(void) {
+    irq_set_pending(usb_task_irq);
+}
+
+// Campainha do núcleo 1 pelo FIFO entre núcleos: há mensagem na fila dele
+static void doorbell_irq(void) {
+    multicore_fifo_drain();
+    multicore_fifo_clear_irq();
+    irq_set_pending(usb_task_irq);
+}
+
+static bool usb_task_timer_cb(struct repeating_timer *t) {
+    irq_set_pending(usb_task_irq);
+    return true;
+}
+
+// --- Driver de stdio na porta de logs ---
+
+static void log_out_chars(const char *buf, int len) {
+    if (!tud_cdc_n_connected(USB_LINK_CDC_LOG)) return; // Sem terminal aberto: descarta em silêncio
+
+    // Outro núcleo ou a IRQ com o TinyUSB: descarta em vez de esperar
+    if (!mutex_try_enter(&usb_mutex, NULL)) {
+        log_dropped_bytes += (uint32_t)len;
+        return;
+    }
+    uint32_t n = tud_cdc_n_write_available(USB_LINK_CDC_LOG);
+    if (n > (uint32_t)len) n = (uint32_t)len;
+    n = tud_cdc_n_write(USB_LINK_CDC_LOG, buf, n);
+    tud_cdc_n_write_flush(USB_LINK_CDC_LOG);
+    mutex_exit(&usb_mutex);
+
+    log_dropped_bytes += (uint32_t)len - n;
+}
+
+static int log_in_chars(char *buf, int len) {
+    int n = PICO_ERROR_NO_DATA;
+
+    mutex_enter_blocking(&usb_mutex);
+    if (tud_cdc_n_available(USB_LINK_CDC_LOG)) {
+        n = (int)tud_cdc_n_read(USB_LINK_CDC_LOG, buf, (uint32_t)len);
+    }
+    mutex_exit(&usb_mutex);
+    return n;
+}
+
+static stdio_driver_t log_driver = {
+    .out_chars = log_out_chars,
+    .in_chars = log_in_chars,
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    .crlf_enabled = PICO_STDIO_DEFAULT_CRLF,
+#endif
+};
+
+// Mesmo gatilho do pico_stdio_usb: abrir a porta de logs a 1200 baud reinicia no BOOTSEL
+void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *coding) {
+    if (itf == USB_LINK_CDC_LOG && coding->bit_rate == 1200) {
+        reset_usb_boot(0, 0);
+    }
+}
+
+void usb_link_init(void) {
+    mutex_init(&usb_mutex);
+    tusb_init();
+
+    usb_task_irq = (uint8_t)user_irq_claim_unused(true);
+    irq_set_exclusive_handler(usb_task_irq, usb_task_irq_handler);
+    irq_set_enabled(usb_task_irq, true);
+
+    if (irq_has_shared_handler(USBCTRL_IRQ)) {
+        irq_add_shared_handler(USBCTRL_IRQ, usb_ctrl_irq, PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+    }
+    // O multicore_launch_core1() desliga esta IRQ enquanto usa o FIFO
+    irq_set_exclusive_handler(SIO_IRQ_PROC0, doorbell_irq);
+    irq_set_enabled(SIO_IRQ_PROC0, true);
+    add_repeating_timer_us(-USB_TASK_INTERVAL_US, usb_task_timer_cb, NULL, &usb_task_timer);
+
+    stdio_set_driver_enabled(&log_driver, true);
+}
+
+bool usb_link_data_connected(void) {
+    return tud_ready() && tud_cdc_n_connected(USB_LINK_CDC_DATA);
+}
+
+bool usb_link_send(const uint8_t *data, size_t len) {
+    tx_queue_t *q = &tx_queue[get_core_num()];
+    uint32_t head = q->head;
+    uint32_t used = head - q->tail;
+
+    // Mensagem inteira ou nada: meio quadro no fio só viraria erro de CRC no host
+    if (len == 0 || len > USB_LINK_MSG_MAX || used >= USB_LINK_QUEUE_DEPTH) {
+        q->dropped_full++;
+        return false;
+    }
+
+    tx_msg_t *msg = &q->slot[head & QUEUE_MASK];
+    memcpy(msg->data, data, len);
+    msg->len = (uint8_t)len;
+
+    __dmb(); // Slot visível antes do novo head
+    q->head = head + 1;
+    q->queued++;
+    if (used + 1 > q->high_water) q->high_water = used + 1;
+
+    // No núcleo 0 a IRQ do USB é local; o núcleo 1 toca a campainha (FIFO
+    // cheio = já há toques pendentes)
+    if (get_core_num() == 0) {
+        irq_set_pending(usb_task_irq);
+    } else if (multicore_fifo_wready()) {
+        multicore_fifo_push_blocking(0);
+    }
+    return true;
+}
+
+void usb_link_get_stats(usb_link_stats_t *out) {
+    out->tx_queued = tx_queue[0].queued + tx_queue[1].queued;
+    out->tx_sent = tx_sent;
+    out->tx_dropped_full = tx_queue[0].dropped_full + tx_queue[1].dropped_full;
+    out->tx_dropped_closed = tx_dropped_closed;
+    out->tx_high_water = tx_queue[0].high_water > tx_queue[1].high_water ? tx_queue[0].high_water : tx_queue[1].high_water;
+    out->log_dropped_bytes = log_dropped_bytes;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file usb_link.h
+ * @brief Dispositivo USB composto: CDC de logs (stdio) + CDC de telemetria
+ *
+ * Antes a telemetria, as mensagens de controle (START_LOG/STOP_LOG) e os
+ * printf de depuração dividiam a mesma porta do stdio_usb, e um log longo
+ * atrasava a telemetria. Agora o Pico aparece no host como duas portas
+ * seriais:
+ *
+ *   CDC 0 "Shift Light log"        stdio (printf), só logs
+ *   CDC 1 "Shift Light telemetria" quadros/linhas do get_rpm.py nos dois sentidos
+ *
+ * O tud_task roda numa IRQ de usuário de baixa prioridade no núcleo 0,
+ * disparada pela IRQ do controlador USB (como fazia o pico_stdio_usb), por
+ * usb_link_send() (no núcleo 1, pela campainha do FIFO entre núcleos) e por
+ * um timer de 10 ms de repescagem. Sem tick de 1 ms, o núcleo 0 pode dormir
+ * em __wfe(). O reset para o bootloader com 1200 baud continua valendo na
+ * porta de logs.
+ *
+ * Mensagens para o host nunca são escritas direto do loop: usb_link_send()
+ * copia a mensagem para uma fila de tamanho fixo e retorna na hora. Cada
+ * núcleo tem a sua fila SPSC (produtor: o núcleo; consumidor: a IRQ do USB),
+ * sem locks. A IRQ esvazia as filas quando há espaço no FIFO de transmissão;
+ * com a fila cheia a mensagem nova é descartada e contada, e com a porta de
+ * telemetria fechada as pendentes são descartadas para não chegarem velhas.
+ * Logs (printf) seguem best-effort na porta de logs, também sem bloquear:
+ * com o TinyUSB ocupado pelo outro núcleo ou pela IRQ, ou com o FIFO de
+ * transmissão cheio, os bytes são descartados e contados.
+ */
+
+#ifndef USB_LINK_H
+#define USB_LINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Instâncias CDC do TinyUSB (argumento itf de tud_cdc_n_*)
+#define USB_LINK_CDC_LOG   0
+#define USB_LINK_CDC_DATA  1
+
+#define USB_LINK_QUEUE_DEPTH 16  // Mensagens por núcleo, potência de 2
+#define USB_LINK_MSG_MAX     100 // Cabe um quadro completo (TP_MAX_FRAME + delimitadores)
+
+typedef struct {
+    uint32_t tx_queued;         // Mensagens aceitas por usb_link_send()
+    uint32_t tx_sent;           // Mensagens entregues ao FIFO do TinyUSB
+    uint32_t tx_dropped_full;   // Descartadas com a fila cheia ou grandes demais
+    uint32_t tx_dropped_closed; // Descartadas com a porta de telemetria fechada
+    uint32_t tx_high_water;     // Maior ocupação de uma fila
+    uint32_t log_dropped_bytes; // Bytes de log descartados
+} usb_link_stats_t;
+
+void usb_link_init(void); // Núcleo 0, depois de stdio_init_all()
+
+// Enfileira uma mensagem para a porta de telemetria; nunca bloqueia. Qualquer
+// núcleo, mas não de dentro de IRQ (um produtor por fila). False = descartada.
+bool usb_link_send(const uint8_t *data, size_t len);
+bool usb_link_data_connected(void);
+
+void usb_link_get_stats(usb_link_stats_t *out);
+
+#endif // USB_LINK_H
@@ -0,0 +1,154 @@
+/**
+ * @file usb_rx.c
+ * @brief Implementação do ring de recepção USB (ver usb_rx.h)
+ */
+
+#include "usb_rx.h"
+#include "usb_link.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+
+#define RING_MASK (USB_RX_RING_SIZE - 1)
+
+static uint8_t ring[USB_RX_RING_SIZE];
+
+// Índices livres (não mascarados); cada um tem um único escritor
+static volatile uint32_t ring_head;   // Escrito pelo produtor
+static volatile uint32_t ring_tail;   // Escrito pelo consumidor
+static volatile uint32_t delim_head;  // Delimitadores recebidos
+static volatile uint32_t delim_tail;  // Delimitadores consumidos
+
+static volatile uint32_t bytes_total;
+static volatile uint32_t frames_total;
+static volatile uint32_t overrun_bytes;
+static volatile uint32_t overruns;
+static volatile uint32_t high_water;
+
+static uint32_t bytes_per_s;
+static uint32_t frames_per_s;
+
+static inline bool is_delimiter(uint8_t c) {
+    return c == '\n' || c == '\r' || c == 0x00;
+}
+
+void usb_rx_init(void) {
+    ring_head = ring_tail = 0;
+    delim_head = delim_tail = 0;
+}
+
+// Chamado pelo TinyUSB dentro do tud_task sempre que chega um pacote OUT
+void tud_cdc_rx_cb(uint8_t itf) {
+    bool got_delimiter = false;
+    bool dropped = false;
+
+    // A porta de logs fica no FIFO do TinyUSB para o stdio (getchar)
+    if (itf != USB_LINK_CDC_DATA) return;
+
+    while (tud_cdc_n_available(itf)) {
+        uint32_t head = ring_head;
+        uint32_t used = head - ring_tail;
+        uint32_t space = USB_RX_RING_SIZE - used;
+
+        if (space == 0) {
+            // Ring cheio: descarta para não travar o endpoint; o CRC do
+            // quadro seguinte/anterior garante que nada corrompido é aplicado
+            uint8_t scratch[64];
+            uint32_t n = tud_cdc_n_read(itf, scratch, sizeof(scratch));
+            overrun_bytes += n;
+            dropped = true;
+            continue;
+        }
+
+        uint32_t contiguous = USB_RX_RING_SIZE - (head & RING_MASK);
+        if (contiguous > space) contiguous = space;
+
+        uint8_t *dst = &ring[head & RING_MASK];
+        uint32_t n = tud_cdc_n_read(itf, dst, contiguous);
+        if (n == 0) break;
+
+        uint32_t delims = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (is_delimiter(dst[i])) delims++;
+        }
+
+        __dmb(); // Dados visíveis antes do novo head
+        ring_head = head + n;
+        delim_head += delims;
+        bytes_total += n;
+        if (used + n > high_water) high_water = used + n;
+        if (delims) got_delimiter = true;
+    }
+
+    if (dropped) overruns++; // Um evento por callback que descartou, não por bloco
+
+    // Acorda o núcleo 1 com mensagem completa no ring, ou com o ring quase
+    // cheio de bytes sem delimitador, para ele esvaziar e ressincronizar
+    if (got_delimiter || dropped || ring_head - ring_tail >= USB_RX_WAKE_LEVEL) {
+        __sev();
+    }
+}
+
+bool usb_rx_frame_ready(void) {
+    // O consumidor pode contar um delimitador um instante antes do produtor
+    if ((int32_t)(delim_head - delim_tail) > 0) return true;
+    return ring_head - ring_tail >= USB_RX_WAKE_LEVEL;
+}
+
+void usb_rx_wait_frame(void) {
+    while (!usb_rx_frame_ready()) {
+        __wfe();
+    }
+}
+
+size_t usb_rx_read(uint8_t *dst, size_t max) {
+    uint32_t tail = ring_tail;
+    uint32_t avail = ring_head - tail;
+    __dmb();
+
+    if (avail > max) avail = max;
+
+    uint32_t delims = 0;
+    for (uint32_t i = 0; i < avail; i++) {
+        uint8_t c = ring[(tail + i) & RING_MASK];
+        if (is_delimiter(c)) delims++;
+        dst[i] = c;
+    }
+
+    __dmb(); // Leitura concluída antes de liberar o espaço
+    ring_tail = tail + avail;
+    delim_tail += delims;
+    return avail;
+}
+
+void usb_rx_count_frame(void) {
+    frames_total++;
+}
+
+void usb_rx_update_rates(uint32_t now_us) {
+    static uint32_t window_start_us;
+    static uint32_t window_bytes;
+    static uint32_t window_frames;
+
+    uint32_t elapsed = now_us - window_start_us;
+    if (elapsed < 1000000) return;
+
+    uint32_t b = bytes_total;
+    uint32_t f = frames_total;
+    bytes_per_s = (uint32_t)((uint64_t)(b - window_bytes) * 1000000 / elapsed);
+    frames_per_s = (uint32_t)((uint64_t)(f - window_frames) * 1000000 / elapsed);
+    window_bytes = b;
+    window_frames = f;
+    window_start_us = now_us;
+}
+
+void usb_rx_get_stats(usb_rx_stats_t *out) {
+    out->bytes_total = bytes_total;
+    out->frames_total = frames_total;
+    out->overrun_bytes = overrun_bytes;
+    out->overruns = overruns;
+    out->bytes_per_s = bytes_per_s;
+    out->frames_per_s = frames_per_s;
+    out->level = ring_head - ring_tail;
+    out->high_water = high_water;
+}
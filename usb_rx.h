@@ -0,0 +1,52 @@
+/**
+ * @file usb_rx.h
+ * @brief Recepção USB CDC em blocos para um ring buffer lock-free (IRQ -> núcleo 1)
+ *
+ * O callback de recepção do TinyUSB (tud_cdc_rx_cb) esvazia o endpoint da
+ * porta de telemetria (USB_LINK_CDC_DATA, ver usb_link.h) em blocos direto
+ * para o ring. Cada delimitador de mensagem ('\n', '\r' ou o
+ * 0x00 dos quadros COBS) gera um __sev(), então o núcleo 1 pode dormir em
+ * __wfe() e só acordar quando existe uma mensagem completa para processar.
+ * Bytes sem delimitador (ruído, host reiniciado no meio de um quadro) também
+ * acordam o núcleo 1 quando o ring passa de USB_RX_WAKE_LEVEL ou enche: ele
+ * esvazia o ring e o tp_rx_t descarta o pedaço até ressincronizar, em vez de
+ * o ring ficar cheio para sempre sem nenhum delimitador que o acorde.
+ *
+ * Produtor: contexto do tud_task (IRQ de baixa prioridade de usb_link.c).
+ * Consumidor: núcleo 1.
+ */
+
+#ifndef USB_RX_H
+#define USB_RX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define USB_RX_RING_SIZE 1024 // Potência de 2
+#define USB_RX_WAKE_LEVEL (USB_RX_RING_SIZE * 3 / 4) // Acorda o consumidor mesmo sem delimitador
+
+typedef struct {
+    uint32_t bytes_total;
+    uint32_t frames_total;
+    uint32_t overrun_bytes;   // Bytes descartados por ring cheio
+    uint32_t overruns;        // Eventos de ring cheio
+    uint32_t bytes_per_s;
+    uint32_t frames_per_s;
+    uint32_t level;           // Ocupação atual do ring
+    uint32_t high_water;      // Maior ocupação já vista
+} usb_rx_stats_t;
+
+void usb_rx_init(void);
+
+// Lado do consumidor (núcleo 1)
+bool usb_rx_frame_ready(void);
+void usb_rx_wait_frame(void);
+size_t usb_rx_read(uint8_t *dst, size_t max);
+void usb_rx_count_frame(void);
+
+// Estatísticas (qualquer núcleo)
+void usb_rx_update_rates(uint32_t now_us);
+void usb_rx_get_stats(usb_rx_stats_t *out);
+
+#endif // USB_RX_H